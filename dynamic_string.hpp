@@ -0,0 +1,340 @@
+/**
+ * @file dynamic_string.hpp
+ * @brief C++ RAII wrappers for dynamic_string.h
+ *
+ * @details
+ * Owning wrappers around ds_string and ds_builder:
+ * - **ds::string** retains on copy, steals on move, releases on destruction
+ * - **ds::builder** owns a StringBuilder and converts to ds::string
+ * - **std::string_view** interop without strlen() on either side; the
+ *   std::string_view constructor is constexpr, so literal lengths are
+ *   computed at compile time
+ * - **std::hash<ds::string>** using ds_hash()
+ *
+ * Requires C++17. Define DS_IMPLEMENTATION in exactly one translation unit;
+ * it may be a C++ file unless DS_ATOMIC_REFCOUNT or DS_THREADS is enabled,
+ * in which case compile the implementation as C.
+ *
+ * @code{.cpp}
+ * #include "dynamic_string.hpp"
+ *
+ * ds::string greeting("Hello");
+ * ds::string full = greeting + ", World!";  // New string, greeting unchanged
+ * std::string_view view = full;             // No copy, no strlen
+ * @endcode
+ *
+ * Allocation failures throw std::bad_alloc.
+ */
+
+#ifndef DYNAMIC_STRING_HPP
+#define DYNAMIC_STRING_HPP
+
+#include "dynamic_string.h"
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ds {
+
+/**
+ * @brief Owning handle to an immutable reference-counted ds_string
+ *
+ * Copies share the same buffer (one ds_retain), moves transfer it without
+ * touching the reference count. A moved-from string is empty.
+ */
+class string {
+public:
+    using size_type = std::size_t;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    /** @brief Empty string (no allocation until a non-empty value is assigned) */
+    string() noexcept = default;
+
+    /** @brief Copy a null-terminated C string */
+    explicit string(const char* text) : str_(checked(ds_new(text))) {}
+
+    /** @brief Copy a range of bytes; embedded nulls are kept */
+    explicit string(std::string_view text) : str_(checked(ds_new_length(text.data(), text.size()))) {}
+
+    string(const string& other) noexcept : str_(other.str_ ? ds_retain(other.str_) : nullptr) {}
+
+    string(string&& other) noexcept : str_(std::exchange(other.str_, nullptr)) {}
+
+    string& operator=(const string& other) noexcept {
+        if (this != &other) {
+            string copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    string& operator=(string&& other) noexcept {
+        string moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    ~string() {
+        if (str_) ds_release(&str_);
+    }
+
+    /**
+     * @brief Take ownership of a reference the caller already holds
+     * @param str String from a C API call that returned a new reference (may be NULL)
+     */
+    static string adopt(ds_string str) noexcept {
+        string result;
+        result.str_ = str;
+        return result;
+    }
+
+    /**
+     * @brief Share a string owned elsewhere, adding one reference
+     * @param str Borrowed string (may be NULL)
+     */
+    static string share(ds_string str) noexcept {
+        return adopt(str ? ds_retain(str) : nullptr);
+    }
+
+    /** @brief Give up ownership without releasing; the caller must ds_release() the result */
+    ds_string release() noexcept { return std::exchange(str_, nullptr); }
+
+    /** @brief Underlying ds_string for C calls (NULL for an empty default-constructed string) */
+    ds_string get() const noexcept { return str_; }
+
+    const char* c_str() const noexcept { return str_ ? str_ : ""; }
+    const char* data() const noexcept { return c_str(); }
+    size_type size() const noexcept { return str_ ? ds_length(str_) : 0; }
+    size_type length() const noexcept { return size(); }
+    bool empty() const noexcept { return size() == 0; }
+    size_type refcount() const noexcept { return str_ ? ds_refcount(str_) : 0; }
+
+    std::string_view view() const noexcept { return std::string_view(c_str(), size()); }
+    operator std::string_view() const noexcept { return view(); }
+    std::string to_std() const { return std::string(view()); }
+
+    char operator[](size_type index) const noexcept { return c_str()[index]; }
+
+    void swap(string& other) noexcept { std::swap(str_, other.str_); }
+
+    /** @brief Concatenate without strlen(), returning a new string */
+    string append(std::string_view text) const {
+        if (!str_) return string(text);
+        return adopt(checked(ds_append_length(str_, text.data(), text.size())));
+    }
+
+    /** @brief Substring by byte offset; out-of-range arguments are clamped */
+    string substr(size_type start, size_type count = npos) const {
+        std::string_view v = view();
+        if (start > v.size()) start = v.size();
+        return string(v.substr(start, count));
+    }
+
+    size_type find(std::string_view needle, size_type start = 0) const noexcept { return view().find(needle, start); }
+    bool contains(std::string_view needle) const noexcept { return find(needle) != npos; }
+
+    bool starts_with(std::string_view prefix) const noexcept {
+        std::string_view v = view();
+        return v.size() >= prefix.size() && v.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    bool ends_with(std::string_view suffix) const noexcept {
+        std::string_view v = view();
+        return v.size() >= suffix.size() && v.compare(v.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    /** @brief Replace the first occurrence of old */
+    string replace(std::string_view old, std::string_view replacement) const {
+        if (!str_) return string(std::string_view()).replace(old, replacement);
+        return adopt(checked(ds_replace_length(str_, old.data(), old.size(), replacement.data(), replacement.size())));
+    }
+
+    /** @brief Replace every occurrence of old */
+    string replace_all(std::string_view old, std::string_view replacement) const {
+        if (!str_) return string();
+        return adopt(
+            checked(ds_replace_all_length(str_, old.data(), old.size(), replacement.data(), replacement.size())));
+    }
+
+    /** @brief Split by a delimiter; an empty delimiter splits into bytes */
+    std::vector<string> split(std::string_view delimiter) const {
+        if (!str_) return string(std::string_view()).split(delimiter);
+        size_t count = 0;
+        ds_string* parts = ds_split_length(str_, delimiter.data(), delimiter.size(), &count);
+        if (!parts && (count > 0 || !delimiter.empty())) throw std::bad_alloc();
+
+        std::vector<string> result;
+        try {
+            result.reserve(count);
+        } catch (...) {
+            ds_free_split_result(parts, count);
+            throw;
+        }
+        for (size_t i = 0; i < count; i++) {
+            result.push_back(adopt(parts[i])); // Cannot throw after reserve
+        }
+        DS_FREE(parts);
+        return result;
+    }
+
+    string to_upper() const { return str_ ? adopt(checked(ds_to_upper(str_))) : string(); }
+    string to_lower() const { return str_ ? adopt(checked(ds_to_lower(str_))) : string(); }
+    string trim() const { return str_ ? adopt(checked(ds_trim(str_))) : string(); }
+
+    /** @brief Hash of the contents, identical to ds_hash() */
+    std::size_t hash() const noexcept {
+        if (str_) return ds_hash(str_);
+        // FNV-1a offset basis: what ds_hash() returns for an empty string
+        return sizeof(std::size_t) == 8 ? static_cast<std::size_t>(14695981039346656037ULL)
+                                        : static_cast<std::size_t>(2166136261U);
+    }
+
+    friend string operator+(const string& a, std::string_view b) { return a.append(b); }
+
+    friend bool operator==(const string& a, const string& b) noexcept {
+        return a.str_ == b.str_ || a.view() == b.view();
+    }
+    friend bool operator!=(const string& a, const string& b) noexcept { return !(a == b); }
+    friend bool operator<(const string& a, const string& b) noexcept { return a.view() < b.view(); }
+    friend bool operator==(const string& a, std::string_view b) noexcept { return a.view() == b; }
+    friend bool operator!=(const string& a, std::string_view b) noexcept { return a.view() != b; }
+
+    friend std::ostream& operator<<(std::ostream& out, const string& str) { return out << str.view(); }
+
+private:
+    static ds_string checked(ds_string str) {
+        if (!str) throw std::bad_alloc();
+        return str;
+    }
+
+    ds_string str_ = nullptr;
+};
+
+inline void swap(string& a, string& b) noexcept { a.swap(b); }
+
+inline namespace literals {
+
+/**
+ * @brief Create a ds::string from a literal whose length the compiler supplies
+ *
+ * @code{.cpp}
+ * using namespace ds::literals;
+ * ds::string key = "content-type"_ds;
+ * @endcode
+ */
+inline string operator""_ds(const char* text, std::size_t length) {
+    return string(std::string_view(text, length));
+}
+
+} // namespace literals
+
+/**
+ * @brief Owning handle to a StringBuilder
+ *
+ * Move-only: copying a builder would share its copy-on-write buffer, which
+ * is rarely what C++ code expects from a value type. A moved-from builder
+ * may only be assigned to or destroyed.
+ */
+class builder {
+public:
+    builder() : sb_(checked(ds_builder_create())) {}
+    explicit builder(std::size_t capacity) : sb_(checked(ds_builder_create_with_capacity(capacity))) {}
+
+    builder(const builder&) = delete;
+    builder& operator=(const builder&) = delete;
+
+    builder(builder&& other) noexcept : sb_(std::exchange(other.sb_, nullptr)) {}
+
+    builder& operator=(builder&& other) noexcept {
+        if (this != &other) {
+            if (sb_) ds_builder_release(&sb_);
+            sb_ = std::exchange(other.sb_, nullptr);
+        }
+        return *this;
+    }
+
+    ~builder() {
+        if (sb_) ds_builder_release(&sb_);
+    }
+
+    /** @brief Append bytes without strlen(); embedded nulls are kept */
+    builder& append(std::string_view text) {
+        if (!text.empty() && !ds_builder_append_length(sb_, text.data(), text.size())) throw std::bad_alloc();
+        return *this;
+    }
+
+    /** @brief Append a string by its stored length */
+    builder& append(const string& str) { return append(str.view()); }
+
+    /** @brief Append a Unicode codepoint as UTF-8 */
+    builder& append_char(uint32_t codepoint) {
+        if (!ds_builder_append_char(sb_, codepoint)) throw std::bad_alloc();
+        return *this;
+    }
+
+    builder& operator<<(std::string_view text) { return append(text); }
+    builder& operator<<(const string& str) { return append(str); }
+    builder& operator<<(const char* text) { return append(std::string_view(text)); }
+
+    builder& operator<<(char c) { return append(std::string_view(&c, 1)); }
+
+    builder& operator<<(long value) {
+        if (!ds_builder_append_long(sb_, value)) throw std::bad_alloc();
+        return *this;
+    }
+
+    builder& operator<<(int value) { return *this << static_cast<long>(value); }
+
+    void clear() noexcept { ds_builder_clear(sb_); }
+    std::size_t size() const noexcept { return ds_builder_length(sb_); }
+    std::size_t capacity() const noexcept { return ds_builder_capacity(sb_); }
+    const char* c_str() const noexcept { return ds_builder_cstr(sb_); }
+    std::string_view view() const noexcept { return std::string_view(c_str(), size()); }
+
+    /** @brief Underlying ds_builder for C calls */
+    ds_builder get() const noexcept { return sb_; }
+
+    /**
+     * @brief Move the contents into an immutable string
+     *
+     * The builder is left empty and ready for reuse.
+     */
+    string to_string() {
+        ds_builder fresh = checked(ds_builder_create());
+        ds_string result = ds_builder_to_string(sb_);
+        if (!result) {
+            ds_builder_release(&fresh);
+            throw std::bad_alloc();
+        }
+        ds_builder_release(&sb_);
+        sb_ = fresh;
+        return string::adopt(result);
+    }
+
+private:
+    static ds_builder checked(ds_builder sb) {
+        if (!sb) throw std::bad_alloc();
+        return sb;
+    }
+
+    ds_builder sb_;
+};
+
+} // namespace ds
+
+namespace std {
+
+template <>
+struct hash<ds::string> {
+    size_t operator()(const ds::string& str) const noexcept { return str.hash(); }
+};
+
+} // namespace std
+
+#endif // DYNAMIC_STRING_HPP
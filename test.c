@@ -2,8 +2,10 @@
 #include "dynamic_string.h"
 #include "libs/unity/unity.h"
 
+#include <pthread.h>
 #include <signal.h>
 #include <setjmp.h>
+#include <time.h>
 
 // Assertion testing mechanism
 static jmp_buf assertion_jump_buffer;
@@ -139,6 +141,44 @@ void test_release_null_safety(void) {
     TEST_ASSERT_NULL(str);
 }
 
+void test_retain_release_array(void) {
+    // More entries than one release batch, with shared, immortal and NULL slots
+    enum { N = 200 };
+    ds_string strings[N];
+    ds_string shared = ds_new("shared entry");
+    for (int i = 0; i < N; i++) {
+        if (i % 10 == 0) {
+            strings[i] = ds_retain(shared);
+        } else if (i % 10 == 1) {
+            strings[i] = NULL;
+        } else if (i % 10 == 2) {
+            strings[i] = ds_new("x"); // Immortal singleton
+        } else {
+            strings[i] = ds_format("entry %d", i);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT(21, ds_refcount(shared));
+
+    ds_retain_array(strings, N);
+    TEST_ASSERT_EQUAL_UINT(41, ds_refcount(shared));
+    TEST_ASSERT_EQUAL_UINT(2, ds_refcount(strings[3]));
+
+    ds_string copies[N];
+    memcpy(copies, strings, sizeof(strings));
+    ds_release_array(copies, N);
+    for (int i = 0; i < N; i++) {
+        TEST_ASSERT_NULL(copies[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT(21, ds_refcount(shared));
+    TEST_ASSERT_EQUAL_UINT(1, ds_refcount(strings[3]));
+    TEST_ASSERT_EQUAL_STRING("entry 199", strings[199]);
+
+    ds_release_array(strings, N); // Last references: frees every heap entry
+    TEST_ASSERT_EQUAL_UINT(1, ds_refcount(shared));
+    ds_release(&shared);
+    ds_release_array(NULL, 0);
+}
+
 // test_retain_null_safety removed - NULL inputs now cause assertions
 
 // ============================================================================
@@ -1481,6 +1521,50 @@ void test_ds_free_split_result(void) {
     ds_release(&str);
 }
 
+void test_split_packed(void) {
+    ds_string line = ds_new("id,name,,x,a much longer field value");
+    size_t count = 0;
+    ds_string* fields = ds_split_packed(line, ",", 1, &count);
+    TEST_ASSERT_NOT_NULL(fields);
+    TEST_ASSERT_EQUAL_UINT(5, count);
+    TEST_ASSERT_EQUAL_STRING("id", fields[0]);
+    TEST_ASSERT_EQUAL_STRING("name", fields[1]);
+    TEST_ASSERT_EQUAL_UINT(0, ds_length(fields[2]));
+    TEST_ASSERT_EQUAL_STRING("x", fields[3]);
+    TEST_ASSERT_EQUAL_UINT(strlen("a much longer field value"), ds_length(fields[4]));
+
+    // Parts live inside the block, right after the pointer array
+    char* block = (char*)fields;
+    TEST_ASSERT_TRUE(fields[0] > block && fields[0] < fields[1] && fields[1] < fields[4]);
+    TEST_ASSERT_TRUE(ds_is_immortal(fields[1]));
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)fields[4] % DS_SIMD_ALIGN);
+
+    // Parts work with the regular API
+    ds_string upper = ds_to_upper(fields[1]);
+    TEST_ASSERT_EQUAL_STRING("NAME", upper);
+    ds_string joined = ds_join(fields, count, ";");
+    TEST_ASSERT_EQUAL_STRING("id;name;;x;a much longer field value", joined);
+    ds_release(&joined);
+    ds_release(&upper);
+    ds_free_split_packed(fields);
+
+    // Same parts as ds_split_length, including bytes and a missing delimiter
+    fields = ds_split_packed(line, NULL, 0, &count);
+    TEST_ASSERT_EQUAL_UINT(ds_length(line), count);
+    TEST_ASSERT_EQUAL_STRING("i", fields[0]);
+    ds_free_split_packed(fields);
+
+    fields = ds_split_packed(line, "::", 2, &count);
+    TEST_ASSERT_EQUAL_UINT(1, count);
+    TEST_ASSERT_EQUAL_STRING(line, fields[0]);
+    ds_free_split_packed(fields);
+
+    ds_string empty = ds_new("");
+    TEST_ASSERT_NULL(ds_split_packed(empty, NULL, 0, &count));
+    TEST_ASSERT_EQUAL_UINT(0, count);
+    ds_release(&line);
+}
+
 void test_ds_refcount(void) {
     ds_string str = ds_new("Hello");
     TEST_ASSERT_EQUAL_UINT(1, ds_refcount(str));
@@ -2024,6 +2108,1784 @@ void test_stringbuilder_combined_operations(void) {
     ds_builder_release(&sb);
 }
 
+// ============================================================================
+// FUZZY MATCHING TESTS
+// ============================================================================
+
+static size_t naive_edit_distance(const char* a, const char* b) {
+    size_t n = strlen(a), m = strlen(b);
+    size_t* row = malloc((m + 1) * sizeof(size_t));
+    for (size_t j = 0; j <= m; j++) row[j] = j;
+    for (size_t i = 1; i <= n; i++) {
+        size_t diag = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= m; j++) {
+            size_t up = row[j];
+            size_t best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best) best = up + 1;
+            if (row[j - 1] + 1 < best) best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    size_t result = row[m];
+    free(row);
+    return result;
+}
+
+void test_edit_distance(void) {
+    ds_string kitten = ds_new("kitten");
+    ds_string sitting = ds_new("sitting");
+    ds_string empty = ds_new("");
+    TEST_ASSERT_EQUAL_UINT(3, ds_edit_distance(kitten, sitting));
+    TEST_ASSERT_EQUAL_UINT(3, ds_edit_distance(sitting, kitten));
+    TEST_ASSERT_EQUAL_UINT(6, ds_edit_distance(kitten, empty));
+    TEST_ASSERT_EQUAL_UINT(0, ds_edit_distance(kitten, kitten));
+
+    // Random strings spanning the single-word and multi-word code paths
+    srand(76);
+    char a[300], b[300];
+    for (int round = 0; round < 40; round++) {
+        size_t la = (size_t)(rand() % 200), lb = (size_t)(rand() % 200);
+        for (size_t i = 0; i < la; i++) a[i] = (char)('a' + rand() % 4);
+        for (size_t i = 0; i < lb; i++) b[i] = (char)('a' + rand() % 4);
+        a[la] = b[lb] = '\0';
+        ds_string sa = ds_new(a);
+        ds_string sb = ds_new(b);
+        TEST_ASSERT_EQUAL_UINT(naive_edit_distance(a, b), ds_edit_distance(sa, sb));
+        ds_release(&sa);
+        ds_release(&sb);
+    }
+
+    ds_release(&kitten);
+    ds_release(&sitting);
+    ds_release(&empty);
+}
+
+void test_fuzzy_index(void) {
+    const char* words[] = {"apple", "apply", "ample", "maple", "applet", "banana", "bandana", "apple"};
+    ds_string dict[8];
+    for (int i = 0; i < 8; i++) dict[i] = ds_new(words[i]);
+
+    ds_fuzzy_index* index = ds_fuzzy_index_build(dict, 8, 1);
+    TEST_ASSERT_EQUAL_UINT(8, ds_fuzzy_index_count(index));
+    TEST_ASSERT_EQUAL_UINT(2, ds_refcount(dict[0])); // Retained by the index
+
+    ds_string query = ds_new("appel");
+    ds_fuzzy_match matches[4];
+    size_t found = ds_fuzzy_index_search(index, query, 2, matches, 4);
+    TEST_ASSERT_EQUAL_UINT(4, found);
+    TEST_ASSERT_EQUAL_UINT(2, matches[0].distance);
+    TEST_ASSERT_EQUAL_UINT(0, matches[0].index);
+    TEST_ASSERT_EQUAL_STRING("apple", matches[0].str);
+    for (size_t i = 0; i < found; i++) {
+        TEST_ASSERT_EQUAL_UINT(naive_edit_distance("appel", words[matches[i].index]), matches[i].distance);
+        if (i > 0) TEST_ASSERT_TRUE(matches[i - 1].distance <= matches[i].distance);
+    }
+
+    ds_string exact = ds_new("bandana");
+    found = ds_fuzzy_index_search(index, exact, 0, matches, 4);
+    TEST_ASSERT_EQUAL_UINT(1, found);
+    TEST_ASSERT_EQUAL_UINT(6, matches[0].index);
+
+    ds_fuzzy_index_free(index);
+    TEST_ASSERT_EQUAL_UINT(1, ds_refcount(dict[0]));
+
+    ds_release(&query);
+    ds_release(&exact);
+    for (int i = 0; i < 8; i++) ds_release(&dict[i]);
+}
+
+void test_fuzzy_index_parallel_build(void) {
+    enum { N = 4096 };
+    ds_string* dict = malloc(N * sizeof(ds_string));
+    srand(77);
+    for (int i = 0; i < N; i++) {
+        char buf[16];
+        size_t len = 3 + (size_t)(rand() % 8);
+        for (size_t j = 0; j < len; j++) buf[j] = (char)('a' + rand() % 6);
+        buf[len] = '\0';
+        dict[i] = ds_new(buf);
+    }
+
+    ds_fuzzy_index* sequential = ds_fuzzy_index_build(dict, N, 1);
+    ds_fuzzy_index* parallel = ds_fuzzy_index_build(dict, N, 4);
+
+    ds_string query = ds_new("abcdef");
+    ds_fuzzy_match a[10], b[10];
+    size_t found_a = ds_fuzzy_index_search(sequential, query, 3, a, 10);
+    size_t found_b = ds_fuzzy_index_search(parallel, query, 3, b, 10);
+    TEST_ASSERT_EQUAL_UINT(found_a, found_b);
+
+    // Brute force agrees on the best distance
+    size_t best = SIZE_MAX;
+    for (int i = 0; i < N; i++) {
+        size_t d = ds_edit_distance(query, dict[i]);
+        if (d < best) best = d;
+    }
+    TEST_ASSERT_TRUE(found_a > 0);
+    TEST_ASSERT_EQUAL_UINT(best, a[0].distance);
+    for (size_t i = 0; i < found_a; i++) {
+        TEST_ASSERT_EQUAL_UINT(a[i].index, b[i].index);
+        TEST_ASSERT_EQUAL_UINT(a[i].distance, b[i].distance);
+    }
+
+    ds_fuzzy_index_free(sequential);
+    ds_fuzzy_index_free(parallel);
+    ds_release(&query);
+    for (int i = 0; i < N; i++) ds_release(&dict[i]);
+    free(dict);
+}
+
+// ============================================================================
+// ADAPTIVE RADIX TREE TESTS
+// ============================================================================
+
+typedef struct {
+    char keys[64][32];
+    size_t count;
+} art_collected;
+
+static int art_collect(void* ctx, const char* key, size_t key_len, void* value) {
+    (void)value;
+    art_collected* out = ctx;
+    memcpy(out->keys[out->count], key, key_len);
+    out->keys[out->count][key_len] = '\0';
+    out->count++;
+    return 0;
+}
+
+static int art_collect_two(void* ctx, const char* key, size_t key_len, void* value) {
+    art_collect(ctx, key, key_len, value);
+    return ((art_collected*)ctx)->count == 2;
+}
+
+void test_art_insert_lookup(void) {
+    ds_art* tree = ds_art_create();
+    int values[300];
+
+    TEST_ASSERT_EQUAL_INT(1, ds_art_insert(tree, "/api/users", 10, &values[0]));
+    TEST_ASSERT_EQUAL_INT(1, ds_art_insert(tree, "/api/", 5, &values[1]));
+    TEST_ASSERT_EQUAL_INT(1, ds_art_insert(tree, "/api/users/admin", 16, &values[2]));
+    TEST_ASSERT_EQUAL_INT(1, ds_art_insert(tree, "", 0, &values[3]));
+    TEST_ASSERT_EQUAL_INT(0, ds_art_insert(tree, "/api/", 5, &values[4])); // Replace
+    TEST_ASSERT_EQUAL_UINT(4, ds_art_size(tree));
+
+    TEST_ASSERT_EQUAL_PTR(&values[0], ds_art_lookup(tree, "/api/users", 10));
+    TEST_ASSERT_EQUAL_PTR(&values[4], ds_art_lookup(tree, "/api/", 5));
+    TEST_ASSERT_EQUAL_PTR(&values[3], ds_art_lookup(tree, "", 0));
+    TEST_ASSERT_NULL(ds_art_lookup(tree, "/api", 4));
+    TEST_ASSERT_NULL(ds_art_lookup(tree, "/api/user", 9));
+
+    // Keys with embedded nulls and every byte value force all node sizes
+    for (int i = 0; i < 256; i++) {
+        char key[3] = {'k', (char)i, '\0'};
+        ds_art_insert(tree, key, 3, &values[i % 300]);
+    }
+    TEST_ASSERT_EQUAL_UINT(260, ds_art_size(tree));
+    for (int i = 0; i < 256; i++) {
+        char key[3] = {'k', (char)i, '\0'};
+        TEST_ASSERT_EQUAL_PTR(&values[i % 300], ds_art_lookup(tree, key, 3));
+    }
+
+    ds_string key = ds_new("/api/users");
+    TEST_ASSERT_EQUAL_PTR(&values[0], ds_art_lookup(tree, key, ds_length(key)));
+    ds_release(&key);
+
+    ds_art_free(tree);
+}
+
+void test_art_longest_prefix(void) {
+    ds_art* tree = ds_art_create();
+    int api, users, root;
+    ds_art_insert(tree, "/", 1, &root);
+    ds_art_insert(tree, "/api/", 5, &api);
+    ds_art_insert(tree, "/api/users/", 11, &users);
+
+    size_t len = 0;
+    TEST_ASSERT_EQUAL_PTR(&users, ds_art_longest_prefix(tree, "/api/users/42", 13, &len));
+    TEST_ASSERT_EQUAL_UINT(11, len);
+    TEST_ASSERT_EQUAL_PTR(&api, ds_art_longest_prefix(tree, "/api/orders", 11, &len));
+    TEST_ASSERT_EQUAL_UINT(5, len);
+    TEST_ASSERT_EQUAL_PTR(&root, ds_art_longest_prefix(tree, "/static/app.js", 14, &len));
+    TEST_ASSERT_EQUAL_UINT(1, len);
+    TEST_ASSERT_NULL(ds_art_longest_prefix(tree, "api", 3, &len));
+    TEST_ASSERT_EQUAL_UINT(0, len);
+
+    ds_art_free(tree);
+}
+
+void test_art_ordered_iteration(void) {
+    const char* words[] = {"banana", "apple", "band", "ban", "cherry", "applesauce", "bandana", "b"};
+    ds_art* tree = ds_art_create();
+    for (int i = 0; i < 8; i++) ds_art_insert(tree, words[i], strlen(words[i]), (void*)words[i]);
+
+    art_collected all = {{{0}}, 0};
+    TEST_ASSERT_EQUAL_INT(0, ds_art_range(tree, NULL, 0, NULL, 0, art_collect, &all));
+    TEST_ASSERT_EQUAL_UINT(8, all.count);
+    const char* sorted[] = {"apple", "applesauce", "b", "ban", "banana", "band", "bandana", "cherry"};
+    for (int i = 0; i < 8; i++) TEST_ASSERT_EQUAL_STRING(sorted[i], all.keys[i]);
+
+    art_collected range = {{{0}}, 0};
+    TEST_ASSERT_EQUAL_INT(0, ds_art_range(tree, "apples", 6, "band", 4, art_collect, &range));
+    TEST_ASSERT_EQUAL_UINT(4, range.count);
+    TEST_ASSERT_EQUAL_STRING("applesauce", range.keys[0]);
+    TEST_ASSERT_EQUAL_STRING("b", range.keys[1]);
+    TEST_ASSERT_EQUAL_STRING("ban", range.keys[2]);
+    TEST_ASSERT_EQUAL_STRING("banana", range.keys[3]);
+
+    // Reaching hi is not a stop; only the callback's own request is
+    art_collected stopped = {{{0}}, 0};
+    TEST_ASSERT_EQUAL_INT(1, ds_art_range(tree, "apples", 6, "band", 4, art_collect_two, &stopped));
+    TEST_ASSERT_EQUAL_UINT(2, stopped.count);
+
+    art_collected prefixed = {{{0}}, 0};
+    ds_art_prefix_iter(tree, "ban", 3, art_collect, &prefixed);
+    TEST_ASSERT_EQUAL_UINT(4, prefixed.count);
+    TEST_ASSERT_EQUAL_STRING("ban", prefixed.keys[0]);
+    TEST_ASSERT_EQUAL_STRING("bandana", prefixed.keys[3]);
+
+    art_collected mid = {{{0}}, 0};
+    ds_art_prefix_iter(tree, "appl", 4, art_collect, &mid);
+    TEST_ASSERT_EQUAL_UINT(2, mid.count);
+
+    art_collected none = {{{0}}, 0};
+    ds_art_prefix_iter(tree, "bx", 2, art_collect, &none);
+    TEST_ASSERT_EQUAL_UINT(0, none.count);
+
+    ds_art_free(tree);
+}
+
+// ============================================================================
+// TEXT INDEX TESTS
+// ============================================================================
+
+static size_t naive_count(const char* text, size_t n, const char* pattern, size_t m) {
+    size_t count = 0;
+    for (size_t i = 0; i + m <= n; i++) {
+        if (memcmp(text + i, pattern, m) == 0) count++;
+    }
+    return count;
+}
+
+void test_text_index_count_locate(void) {
+    ds_string text = ds_new("abracadabra abracadabra");
+    ds_text_index* index = ds_text_index_build(text, 1);
+    TEST_ASSERT_EQUAL_UINT(23, ds_text_index_length(index));
+
+    TEST_ASSERT_EQUAL_UINT(4, ds_text_index_count(index, "abra", 4));
+    TEST_ASSERT_EQUAL_UINT(2, ds_text_index_count(index, "cad", 3));
+    TEST_ASSERT_EQUAL_UINT(0, ds_text_index_count(index, "abba", 4));
+    TEST_ASSERT_EQUAL_UINT(10, ds_text_index_count(index, "a", 1));
+
+    size_t positions[8];
+    size_t found = ds_text_index_locate(index, "abra", 4, positions, 8);
+    TEST_ASSERT_EQUAL_UINT(4, found);
+    TEST_ASSERT_EQUAL_UINT(0, positions[0]);
+    TEST_ASSERT_EQUAL_UINT(7, positions[1]);
+    TEST_ASSERT_EQUAL_UINT(12, positions[2]);
+    TEST_ASSERT_EQUAL_UINT(19, positions[3]);
+    TEST_ASSERT_EQUAL_UINT(2, ds_text_index_locate(index, "abra", 4, positions, 2));
+
+    ds_text_index_free(index);
+    ds_release(&text);
+
+    ds_string empty = ds_new("");
+    index = ds_text_index_build(empty, 1);
+    TEST_ASSERT_EQUAL_UINT(0, ds_text_index_count(index, "a", 1));
+    ds_text_index_free(index);
+    ds_release(&empty);
+}
+
+void test_text_index_matches_naive_search(void) {
+    // Small alphabet with embedded nulls exercises repeated LMS names and recursion
+    enum { N = 5000 };
+    char* raw = malloc(N);
+    srand(78);
+    for (size_t i = 0; i < N; i++) raw[i] = "ab\0c"[rand() % 4];
+    ds_builder sb = ds_builder_create();
+    ds_builder_append_length(sb, raw, N);
+    ds_string text = ds_builder_to_string(sb);
+    ds_builder_release(&sb);
+    TEST_ASSERT_EQUAL_UINT(N, ds_length(text));
+
+    ds_text_index* index = ds_text_index_build(text, 4);
+    for (int round = 0; round < 200; round++) {
+        size_t m = 1 + (size_t)(rand() % 6);
+        size_t start = (size_t)rand() % (N - m);
+        TEST_ASSERT_EQUAL_UINT(naive_count(raw, N, raw + start, m), ds_text_index_count(index, raw + start, m));
+    }
+
+    // Round-trip through a file
+    const char* path = "test_text_index.bin";
+    TEST_ASSERT_TRUE(ds_text_index_save(index, path));
+    ds_text_index* loaded = ds_text_index_load(path);
+    TEST_ASSERT_NOT_NULL(loaded);
+    size_t a[64], b[64];
+    size_t found_a = ds_text_index_locate(index, "abc", 3, a, 64);
+    size_t found_b = ds_text_index_locate(loaded, "abc", 3, b, 64);
+    TEST_ASSERT_EQUAL_UINT(found_a, found_b);
+    for (size_t i = 0; i < found_a; i++) {
+        TEST_ASSERT_EQUAL_UINT(a[i], b[i]);
+        TEST_ASSERT_EQUAL_INT(0, memcmp(raw + a[i], "abc", 3));
+    }
+    remove(path);
+    TEST_ASSERT_NULL(ds_text_index_load(path));
+
+    // Corrupt lengths and suffix array entries are rejected, not trusted
+    uint64_t patches[2][2] = {{8, 1ULL << 62}, {2080, (uint64_t)N + 1}}; // {offset, value}: n, then sa[0]
+    for (int p = 0; p < 2; p++) {
+        TEST_ASSERT_TRUE(ds_text_index_save(index, path));
+        FILE* f = fopen(path, "r+b");
+        fseek(f, (long)patches[p][0], SEEK_SET);
+        fwrite(&patches[p][1], sizeof(uint64_t), 1, f);
+        fclose(f);
+        TEST_ASSERT_NULL(ds_text_index_load(path));
+        remove(path);
+    }
+
+    ds_text_index_free(index);
+    ds_text_index_free(loaded);
+    ds_release(&text);
+    free(raw);
+}
+
+// ============================================================================
+// STRING TABLE TESTS
+// ============================================================================
+
+void test_table_save_load_mmap(void) {
+    const char* words[] = {"alpha", "", "a much longer string that spans several words", "z"};
+    ds_string strings[4];
+    for (int i = 0; i < 4; i++) strings[i] = ds_new(words[i]);
+
+    const char* path = "test_table.dst";
+    TEST_ASSERT_TRUE(ds_table_save(strings, 4, path));
+
+    ds_table* table = ds_table_load_mmap(path);
+    TEST_ASSERT_NOT_NULL(table);
+    TEST_ASSERT_EQUAL_UINT(4, ds_table_count(table));
+
+    ds_string* loaded = ds_table_strings(table);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_STRING(words[i], loaded[i]);
+        TEST_ASSERT_EQUAL_UINT(strlen(words[i]), ds_length(loaded[i]));
+        TEST_ASSERT_TRUE(ds_is_immortal(loaded[i]));
+        TEST_ASSERT_EQUAL_UINT(SIZE_MAX, ds_refcount(loaded[i]));
+    }
+
+    // Retain/release are no-ops on the read-only mapping
+    ds_string shared = ds_retain(loaded[0]);
+    TEST_ASSERT_EQUAL_PTR(loaded[0], shared);
+    ds_release(&shared);
+    TEST_ASSERT_NULL(shared);
+    TEST_ASSERT_EQUAL_STRING("alpha", loaded[0]);
+
+    // Loaded strings work with the rest of the API
+    ds_string joined = ds_append(loaded[0], "-beta");
+    TEST_ASSERT_EQUAL_STRING("alpha-beta", joined);
+    TEST_ASSERT_FALSE(ds_is_immortal(joined));
+    ds_release(&joined);
+
+    ds_table_close(table);
+    remove(path);
+    TEST_ASSERT_NULL(ds_table_load_mmap(path));
+
+    for (int i = 0; i < 4; i++) ds_release(&strings[i]);
+}
+
+void test_table_rejects_invalid_file(void) {
+    const char* path = "test_table_invalid.dst";
+    FILE* f = fopen(path, "wb");
+    fputs("not a string table", f);
+    fclose(f);
+    TEST_ASSERT_NULL(ds_table_load_mmap(path));
+    remove(path);
+
+    TEST_ASSERT_TRUE(ds_table_save(NULL, 0, path));
+    ds_table* empty = ds_table_load_mmap(path);
+    TEST_ASSERT_NOT_NULL(empty);
+    TEST_ASSERT_EQUAL_UINT(0, ds_table_count(empty));
+    ds_table_close(empty);
+    remove(path);
+
+    // Damaged records: bad type byte, mortal flags, truncated data
+    ds_string strings[2] = {ds_new("first record"), ds_new("second record")};
+    TEST_ASSERT_TRUE(ds_table_save(strings, 2, path));
+    ds_release_array(strings, 2);
+    f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    size_t size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* image = (char*)malloc(size);
+    TEST_ASSERT_EQUAL_UINT(size, fread(image, 1, size, f));
+    fclose(f);
+
+    uint64_t offset;
+    memcpy(&offset, image + 32, sizeof(offset)); // First entry of the offsets table
+    size_t damage[3][2] = {{(size_t)offset - 1, 7}, {(size_t)offset - 2, 0}, {0, 0}}; // {byte, value}
+    for (int d = 0; d < 3; d++) {
+        char saved = image[damage[d][0]];
+        if (d < 2) image[damage[d][0]] = (char)damage[d][1];
+        f = fopen(path, "wb");
+        fwrite(image, 1, d < 2 ? size : size - 2, f);
+        fclose(f);
+        image[damage[d][0]] = saved;
+        TEST_ASSERT_NULL(ds_table_load_mmap(path));
+    }
+    free(image);
+    remove(path);
+}
+
+// ============================================================================
+// FREEZE TESTS
+// ============================================================================
+
+void test_freeze_unfreeze(void) {
+    ds_string str = ds_new("shared dataset entry");
+    ds_string extra = ds_retain(str);
+    TEST_ASSERT_EQUAL_UINT(2, ds_refcount(str));
+
+    ds_freeze(str);
+    TEST_ASSERT_TRUE(ds_is_immortal(str));
+    TEST_ASSERT_EQUAL_UINT(SIZE_MAX, ds_refcount(str));
+
+    // Read-only use never touches the header bytes
+    unsigned char before[sizeof(ds_hdr16)], after[sizeof(ds_hdr16)];
+    memcpy(before, str - sizeof(ds_hdr16), sizeof before);
+    for (int i = 0; i < 1000; i++) {
+        ds_string ref = ds_retain(str);
+        ds_release(&ref);
+    }
+    ds_freeze(str);
+    memcpy(after, str - sizeof(ds_hdr16), sizeof after);
+    TEST_ASSERT_EQUAL_MEMORY(before, after, sizeof before);
+
+    // Unfreezing restores the count held at freeze time
+    ds_unfreeze(str);
+    TEST_ASSERT_FALSE(ds_is_immortal(str));
+    TEST_ASSERT_EQUAL_UINT(2, ds_refcount(str));
+    ds_release(&extra);
+    ds_release(&str);
+}
+
+void test_freeze_array(void) {
+    ds_string strings[3] = {ds_new("a"), NULL, ds_new("c")};
+    ds_freeze_array(strings, 3);
+    TEST_ASSERT_TRUE(ds_is_immortal(strings[0]));
+    TEST_ASSERT_TRUE(ds_is_immortal(strings[2]));
+
+    ds_unfreeze(strings[0]);
+    ds_unfreeze(strings[2]);
+    ds_release(&strings[0]);
+    ds_release(&strings[2]);
+}
+
+void test_unfreeze_leaves_other_immortals(void) {
+    // Packed split parts share one block; unfreezing one must not make it freeable
+    ds_string line = ds_new("alpha,beta");
+    size_t count = 0;
+    ds_string* fields = ds_split_packed(line, ",", 1, &count);
+    ds_freeze(fields[0]);
+    ds_unfreeze(fields[0]);
+    ds_unfreeze(fields[1]);
+    TEST_ASSERT_TRUE(ds_is_immortal(fields[0]));
+    TEST_ASSERT_TRUE(ds_is_immortal(fields[1]));
+    ds_string ref = ds_retain(fields[1]);
+    ds_release(&ref);
+    TEST_ASSERT_EQUAL_STRING("beta", fields[1]);
+    ds_free_split_packed(fields);
+    ds_release(&line);
+}
+
+// ============================================================================
+// COMPRESSED VECTOR TESTS
+// ============================================================================
+
+void test_compressed_vec_roundtrip(void) {
+    const size_t count = 2000;
+    ds_string* strings = malloc(count * sizeof(ds_string));
+    size_t raw_bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        strings[i] = ds_format("https://www.example.com/products/%zu/reviews?page=%zu", i * 7, i % 13);
+        raw_bytes += ds_length(strings[i]);
+    }
+
+    ds_compressed_vec* vec = ds_compressed_vec_build(strings, count);
+    TEST_ASSERT_NOT_NULL(vec);
+    TEST_ASSERT_EQUAL_UINT(count, ds_compressed_vec_count(vec));
+    TEST_ASSERT_TRUE(ds_compressed_vec_memory(vec) < raw_bytes);
+
+    char buffer[128];
+    ds_builder sb = ds_builder_create();
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_UINT(ds_length(strings[i]), ds_compressed_vec_length(vec, i));
+        TEST_ASSERT_EQUAL_UINT(ds_length(strings[i]), ds_compressed_vec_decode(vec, i, buffer, sizeof(buffer)));
+        TEST_ASSERT_EQUAL_STRING(strings[i], buffer);
+
+        ds_string copy = ds_compressed_vec_get(vec, i);
+        TEST_ASSERT_EQUAL_STRING(strings[i], copy);
+        TEST_ASSERT_EQUAL_UINT(ds_length(strings[i]), ds_length(copy));
+        ds_release(&copy);
+
+        ds_builder_clear(sb);
+        TEST_ASSERT_TRUE(ds_builder_append_compressed(sb, vec, i));
+        TEST_ASSERT_EQUAL_STRING(strings[i], ds_builder_cstr(sb));
+    }
+    ds_builder_release(&sb);
+
+    // Truncated output behaves like snprintf
+    size_t full = ds_compressed_vec_decode(vec, 5, buffer, 10);
+    TEST_ASSERT_EQUAL_UINT(ds_length(strings[5]), full);
+    TEST_ASSERT_EQUAL_UINT(9, strlen(buffer));
+    TEST_ASSERT_EQUAL_MEMORY(strings[5], buffer, 9);
+
+    ds_compressed_vec_free(vec);
+    for (size_t i = 0; i < count; i++) ds_release(&strings[i]);
+    free(strings);
+}
+
+void test_compressed_vec_find(void) {
+    ds_string strings[5] = {ds_new("Mozilla/5.0 (X11; Linux x86_64)"), ds_new(""),
+                            ds_new("Mozilla/5.0 (Windows NT 10.0)"), ds_new("binary\x01\xff bytes"),
+                            ds_new("Mozilla/5.0 (X11; Linux x86_64)")};
+    ds_compressed_vec* vec = ds_compressed_vec_build(strings, 5);
+
+    const char* needle = "Mozilla/5.0 (X11; Linux x86_64)";
+    TEST_ASSERT_EQUAL_UINT(0, ds_compressed_vec_find(vec, needle, strlen(needle), 0));
+    TEST_ASSERT_EQUAL_UINT(4, ds_compressed_vec_find(vec, needle, strlen(needle), 1));
+    TEST_ASSERT_EQUAL_UINT(1, ds_compressed_vec_find(vec, "", 0, 0));
+    TEST_ASSERT_EQUAL_UINT(3, ds_compressed_vec_find(vec, "binary\x01\xff bytes", 14, 0));
+    TEST_ASSERT_EQUAL_UINT(SIZE_MAX, ds_compressed_vec_find(vec, "Mozilla/5.0", 11, 0));
+
+    ds_compressed_vec_free(vec);
+    for (int i = 0; i < 5; i++) ds_release(&strings[i]);
+
+    ds_compressed_vec* empty = ds_compressed_vec_build(NULL, 0);
+    TEST_ASSERT_EQUAL_UINT(0, ds_compressed_vec_count(empty));
+    TEST_ASSERT_EQUAL_UINT(SIZE_MAX, ds_compressed_vec_find(empty, "x", 1, 0));
+    ds_compressed_vec_free(empty);
+}
+
+// ============================================================================
+// DICTIONARY COLUMN TESTS
+// ============================================================================
+
+void test_dict_column_append_and_filter(void) {
+    ds_string line = ds_new("US,DE,US,FR,DE,US");
+    size_t count;
+    ds_string* fields = ds_split(line, ",", &count);
+
+    ds_dict_column* column = ds_dict_column_create();
+    TEST_ASSERT_TRUE(ds_dict_column_append_array(column, fields, count, 1));
+    ds_free_split_result(fields, count);
+    ds_release(&line);
+
+    TEST_ASSERT_EQUAL_UINT(6, ds_dict_column_count(column));
+    TEST_ASSERT_EQUAL_UINT(3, ds_dict_column_cardinality(column));
+    TEST_ASSERT_EQUAL_UINT(1, ds_dict_column_code_width(column));
+    TEST_ASSERT_EQUAL_STRING("FR", ds_dict_column_get(column, 3));
+    TEST_ASSERT_EQUAL_UINT(2, ds_dict_column_code(column, 3));
+    TEST_ASSERT_EQUAL_STRING("DE", ds_dict_column_value(column, 1));
+    TEST_ASSERT_EQUAL_UINT(1, ds_dict_column_lookup(column, "DE", 2));
+    TEST_ASSERT_EQUAL_UINT(SIZE_MAX, ds_dict_column_lookup(column, "GB", 2));
+
+    // Equal rows share one dictionary reference
+    TEST_ASSERT_TRUE(ds_dict_column_get(column, 0) == ds_dict_column_get(column, 5));
+    TEST_ASSERT_EQUAL_UINT(1, ds_refcount(ds_dict_column_get(column, 0)));
+
+    size_t rows[2];
+    TEST_ASSERT_EQUAL_UINT(3, ds_dict_column_filter_eq(column, "US", 2, rows, 2));
+    TEST_ASSERT_EQUAL_UINT(0, rows[0]);
+    TEST_ASSERT_EQUAL_UINT(2, rows[1]);
+    TEST_ASSERT_EQUAL_UINT(0, ds_dict_column_filter_eq(column, "GB", 2, NULL, 0));
+
+    ds_dict_column_free(column);
+}
+
+void test_dict_column_widening_and_parallel_build(void) {
+    const size_t count = 100000;
+    ds_string* values = malloc(count * sizeof(ds_string));
+    for (size_t i = 0; i < count; i++) {
+        values[i] = ds_format("status-%zu", (i * 7919) % 70000);
+    }
+
+    ds_dict_column* serial = ds_dict_column_create();
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(ds_dict_column_append(serial, values[i]));
+    }
+    ds_dict_column* parallel = ds_dict_column_create();
+    TEST_ASSERT_TRUE(ds_dict_column_append_array(parallel, values, count, 4));
+
+    TEST_ASSERT_EQUAL_UINT(70000, ds_dict_column_cardinality(serial));
+    TEST_ASSERT_EQUAL_UINT(4, ds_dict_column_code_width(serial));
+    TEST_ASSERT_EQUAL_UINT(count, ds_dict_column_count(parallel));
+    TEST_ASSERT_EQUAL_UINT(70000, ds_dict_column_cardinality(parallel));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_UINT(ds_dict_column_code(serial, i), ds_dict_column_code(parallel, i));
+        TEST_ASSERT_EQUAL_STRING(values[i], ds_dict_column_get(parallel, i));
+    }
+
+    ds_dict_column_free(serial);
+    ds_dict_column_free(parallel);
+    for (size_t i = 0; i < count; i++) ds_release(&values[i]);
+    free(values);
+}
+
+// ============================================================================
+// LENGTH VARIANT TESTS
+// ============================================================================
+
+void test_length_variants(void) {
+    ds_string str = ds_new_length(DS_LIT("a,b,,c"));
+    TEST_ASSERT_EQUAL_UINT(6, ds_length(str));
+
+    ds_string appended = ds_append_length(str, DS_LIT(",d"));
+    TEST_ASSERT_EQUAL_STRING("a,b,,c,d", appended);
+    TEST_ASSERT_EQUAL_INT(3, ds_find_length(appended, DS_LIT(",,")));
+    TEST_ASSERT_EQUAL_INT(-1, ds_find_length(appended, DS_LIT(";")));
+    TEST_ASSERT_EQUAL_INT(0, ds_find_length(appended, NULL, 0));
+
+    ds_string replaced = ds_replace_length(appended, DS_LIT(","), DS_LIT("; "));
+    TEST_ASSERT_EQUAL_STRING("a; b,,c,d", replaced);
+    ds_string replaced_all = ds_replace_all_length(appended, DS_LIT(","), DS_LIT(""));
+    TEST_ASSERT_EQUAL_STRING("abcd", replaced_all);
+    TEST_ASSERT_EQUAL_UINT(4, ds_length(replaced_all));
+
+    size_t count;
+    ds_string* parts = ds_split_length(appended, DS_LIT(","), &count);
+    TEST_ASSERT_EQUAL_UINT(5, count);
+    TEST_ASSERT_EQUAL_STRING("", parts[2]);
+    TEST_ASSERT_EQUAL_STRING("d", parts[4]);
+
+    ds_string joined = ds_join_length(parts, count, DS_LIT(" | "));
+    TEST_ASSERT_EQUAL_STRING("a | b |  | c | d", joined);
+    TEST_ASSERT_EQUAL_UINT(16, ds_length(joined));
+
+    ds_free_split_result(parts, count);
+    ds_release(&str);
+    ds_release(&appended);
+    ds_release(&replaced);
+    ds_release(&replaced_all);
+    ds_release(&joined);
+}
+
+void test_length_variants_embedded_nulls(void) {
+    // Unlike ds_create_length(), ds_new_length() keeps every byte
+    ds_string str = ds_new_length("k\0v\0k\0w", 7);
+    TEST_ASSERT_EQUAL_UINT(7, ds_length(str));
+    TEST_ASSERT_EQUAL_INT(4, ds_find_length(str, "k\0w", 3));
+
+    size_t count;
+    ds_string* parts = ds_split_length(str, "\0", 1, &count);
+    TEST_ASSERT_EQUAL_UINT(4, count);
+    TEST_ASSERT_EQUAL_STRING("w", parts[3]);
+    ds_free_split_result(parts, count);
+
+    ds_string swapped = ds_replace_all_length(str, "\0", 1, "=", 1);
+    TEST_ASSERT_EQUAL_STRING("k=v=k=w", swapped);
+
+    ds_string truncated = ds_create_length(str, 7);
+    TEST_ASSERT_EQUAL_UINT(1, ds_length(truncated));
+
+    ds_string literal = ds_from_literal("literal");
+    TEST_ASSERT_EQUAL_UINT(7, ds_length(literal));
+
+    ds_release(&str);
+    ds_release(&swapped);
+    ds_release(&truncated);
+    ds_release(&literal);
+}
+
+// ============================================================================
+// ALLOCATOR TESTS
+// ============================================================================
+
+typedef struct {
+    size_t live_bytes;
+    size_t calls;
+} counting_allocator_state;
+
+// Blocks are 32-byte aligned so the allocator also satisfies DS_SIMD_ALIGN builds
+#define COUNTING_ALIGN 32
+
+static void* counting_allocate(void* ctx, size_t size) {
+    counting_allocator_state* state = (counting_allocator_state*)ctx;
+    state->live_bytes += size;
+    state->calls++;
+    return aligned_alloc(COUNTING_ALIGN, (size + COUNTING_ALIGN - 1) & ~(size_t)(COUNTING_ALIGN - 1));
+}
+
+static void* counting_reallocate(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    counting_allocator_state* state = (counting_allocator_state*)ctx;
+    state->live_bytes += new_size - old_size;
+    state->calls++;
+    void* moved = aligned_alloc(COUNTING_ALIGN, (new_size + COUNTING_ALIGN - 1) & ~(size_t)(COUNTING_ALIGN - 1));
+    if (moved) {
+        memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+        free(ptr);
+    }
+    return moved;
+}
+
+static void counting_deallocate(void* ctx, void* ptr, size_t size) {
+    counting_allocator_state* state = (counting_allocator_state*)ctx;
+    state->live_bytes -= size;
+    state->calls++;
+    free(ptr);
+}
+
+void test_string_with_allocator(void) {
+    counting_allocator_state state = {0, 0};
+    ds_allocator allocator = {counting_allocate, counting_reallocate, counting_deallocate, &state};
+
+    ds_string str = ds_new_with_allocator("tenant data", &allocator);
+    TEST_ASSERT_EQUAL_STRING("tenant data", str);
+    TEST_ASSERT_TRUE(ds_string_allocator(str) == &allocator);
+    TEST_ASSERT_TRUE(state.live_bytes > ds_length(str));
+    TEST_ASSERT_EQUAL_UINT(1, ds_refcount(str));
+
+    ds_string shared = ds_retain(str);
+    TEST_ASSERT_EQUAL_UINT(2, ds_refcount(str));
+    TEST_ASSERT_TRUE(ds_is_shared(str));
+    ds_release(&shared);
+
+    // Derived strings use the default allocator
+    ds_string derived = ds_append(str, "!");
+    TEST_ASSERT_NULL(ds_string_allocator(derived));
+    ds_release(&derived);
+
+    ds_string bytes = ds_new_length_with_allocator("a\0b", 3, &allocator);
+    TEST_ASSERT_EQUAL_UINT(3, ds_length(bytes));
+    ds_release(&bytes);
+
+    ds_release(&str);
+    TEST_ASSERT_EQUAL_UINT(0, state.live_bytes);
+}
+
+void test_builder_with_allocator(void) {
+    counting_allocator_state state = {0, 0};
+    ds_allocator allocator = {counting_allocate, counting_reallocate, counting_deallocate, &state};
+
+    ds_builder sb = ds_builder_create_with_allocator(4, &allocator);
+    for (int i = 0; i < 100; i++) {
+        ds_builder_append(sb, "chunk ");
+    }
+    TEST_ASSERT_EQUAL_UINT(600, ds_builder_length(sb));
+
+    // Copy-on-write keeps the builder's allocator
+    ds_string snapshot = ds_retain(sb->data);
+    ds_builder_append(sb, "more");
+    TEST_ASSERT_TRUE(ds_string_allocator(sb->data) == &allocator);
+    ds_release(&snapshot);
+
+    ds_string result = ds_builder_to_string(sb);
+    ds_builder_release(&sb);
+    TEST_ASSERT_TRUE(ds_string_allocator(result) == &allocator);
+    TEST_ASSERT_EQUAL_UINT(604, ds_length(result));
+
+    ds_release(&result);
+    TEST_ASSERT_EQUAL_UINT(0, state.live_bytes);
+    TEST_ASSERT_TRUE(state.calls > 3);
+}
+
+// ============================================================================
+// HEADER LAYOUT TESTS
+// ============================================================================
+
+static size_t header_bytes(ds_string str) { return ds_header_sizes[ds_type(str)]; }
+
+void test_compact_header_sizes(void) {
+    ds_string tiny = ds_new("key");
+    TEST_ASSERT_EQUAL_UINT(8, header_bytes(tiny));
+    TEST_ASSERT_EQUAL_UINT(1, ds_refcount(tiny));
+
+    // Footprint of one short key: header + bytes + terminator, nothing else
+    counting_allocator_state state = {0, 0};
+    ds_allocator allocator = {counting_allocate, counting_reallocate, counting_deallocate, &state};
+    ds_string counted = ds_new_with_allocator("0123456789", &allocator);
+    #if DS_SIMD_PADDING == 0 && DS_SIMD_ALIGN == 1
+    TEST_ASSERT_EQUAL_UINT(sizeof(ds_alloc_prefix) + 8 + 11, state.live_bytes);
+#endif
+    ds_release(&counted);
+
+    char* text = (char*)malloc(70001);
+    memset(text, 'x', 70000);
+    text[70000] = '\0';
+    ds_string medium = ds_new(text);
+    TEST_ASSERT_EQUAL_UINT(12, header_bytes(medium));
+    TEST_ASSERT_EQUAL_UINT(70000, ds_length(medium));
+    ds_string copy = ds_retain(medium);
+    TEST_ASSERT_EQUAL_UINT(2, ds_refcount(medium));
+    ds_release(&copy);
+
+    // Boundary: 65535 still fits the 16-bit length
+    text[65535] = '\0';
+    ds_string edge = ds_new(text);
+    TEST_ASSERT_EQUAL_UINT(8, header_bytes(edge));
+    TEST_ASSERT_EQUAL_UINT(65535, ds_length(edge));
+
+    ds_string joined = ds_append(edge, "y");
+    TEST_ASSERT_EQUAL_UINT(12, header_bytes(joined));
+    TEST_ASSERT_EQUAL_UINT(65536, ds_length(joined));
+
+    free(text);
+    ds_release(&joined);
+    ds_release(&edge);
+    ds_release(&medium);
+    ds_release(&tiny);
+}
+
+void test_builder_result_compacted(void) {
+    ds_builder sb = ds_builder_create();
+    TEST_ASSERT_EQUAL_UINT(sizeof(ds_hdr64), header_bytes(sb->data));
+    ds_builder_append(sb, "user:");
+    ds_builder_append_int(sb, 42);
+    ds_string result = ds_builder_to_string(sb);
+    TEST_ASSERT_EQUAL_STRING("user:42", result);
+    TEST_ASSERT_EQUAL_UINT(7, ds_length(result));
+    TEST_ASSERT_EQUAL_UINT(8, header_bytes(result));
+    ds_freeze(result);
+    TEST_ASSERT_TRUE(ds_is_immortal(result));
+    ds_unfreeze(result);
+    ds_release(&result);
+    ds_builder_release(&sb);
+
+    // A shared buffer keeps its header; the other owner still points at it
+    ds_builder shared_sb = ds_builder_create();
+    ds_builder_append(shared_sb, "shared");
+    ds_string other = ds_retain(shared_sb->data);
+    ds_string shared_result = ds_builder_to_string(shared_sb);
+    TEST_ASSERT_TRUE(shared_result == other);
+    TEST_ASSERT_EQUAL_UINT(sizeof(ds_hdr64), header_bytes(shared_result));
+    TEST_ASSERT_EQUAL_UINT(2, ds_refcount(shared_result));
+    ds_release(&other);
+    ds_release(&shared_result);
+    ds_builder_release(&shared_sb);
+}
+
+// ============================================================================
+// SIMD PADDING TESTS
+// ============================================================================
+
+static void assert_padded(ds_string str) {
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)str % DS_SIMD_ALIGN);
+    size_t length = ds_length(str);
+    TEST_ASSERT_EQUAL_CHAR('\0', str[length]);
+    for (size_t i = 1; i <= DS_SIMD_PADDING; i++) {
+        TEST_ASSERT_EQUAL_CHAR('\0', str[length + i]);
+    }
+}
+
+void test_simd_padding_contract(void) {
+    ds_string empty = ds_new("");
+    ds_string word = ds_new("vectorised");
+    ds_string upper = ds_to_upper(word);
+    assert_padded(empty);
+    assert_padded(word);
+    assert_padded(upper);
+
+    // Builders stay aligned while growing and hand back a padded result
+    ds_builder sb = ds_builder_create_with_capacity(4);
+    for (int i = 0; i < 50; i++) {
+        ds_builder_append(sb, "0123456789abcdef");
+        TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)sb->data % DS_SIMD_ALIGN);
+    }
+    ds_builder_remove_range(sb, 5, 700); // Leaves stale bytes past the terminator
+    ds_string built = ds_builder_to_string(sb);
+    TEST_ASSERT_EQUAL_UINT(100, ds_length(built));
+    assert_padded(built);
+
+    // Allocator-owned strings keep the same layout behind the prefix
+    counting_allocator_state state = {0, 0};
+    ds_allocator allocator = {counting_allocate, counting_reallocate, counting_deallocate, &state};
+    ds_string owned = ds_new_with_allocator("tenant", &allocator);
+    assert_padded(owned);
+    ds_release(&owned);
+    TEST_ASSERT_EQUAL_UINT(0, state.live_bytes);
+
+    ds_release(&built);
+    ds_builder_release(&sb);
+    ds_release(&upper);
+    ds_release(&word);
+    ds_release(&empty);
+}
+
+// ============================================================================
+// SMALL STRING SINGLETON TESTS
+// ============================================================================
+
+void test_small_string_singletons(void) {
+    ds_string empty = ds_new("");
+    ds_string also_empty = ds_empty();
+    ds_string none = ds_repeat(empty, 0);
+    TEST_ASSERT_TRUE(empty == also_empty);
+    TEST_ASSERT_TRUE(empty == none);
+    TEST_ASSERT_TRUE(ds_is_immortal(empty));
+    TEST_ASSERT_EQUAL_UINT(0, ds_length(empty));
+
+    ds_string source = ds_new("xay");
+    ds_string a = ds_new("a");
+    ds_string sub = ds_substring(source, 1, 1);
+    TEST_ASSERT_TRUE(a == sub);
+    TEST_ASSERT_EQUAL_STRING("a", a);
+    TEST_ASSERT_EQUAL_UINT(1, ds_length(a));
+
+    // Every byte value, including NUL and high bytes, has its own singleton
+    ds_string high = ds_new_length("\xFF", 1);
+    ds_string nul = ds_new_length("\0", 1);
+    TEST_ASSERT_EQUAL_UINT8(0xFF, (unsigned char)high[0]);
+    TEST_ASSERT_EQUAL_UINT(1, ds_length(nul));
+    TEST_ASSERT_TRUE(nul != empty);
+
+    // Results that come out at 0 or 1 bytes are shared too
+    ds_string ab = ds_new("ab");
+    ds_string joined = ds_concat(empty, a);
+    ds_string replaced = ds_replace(ab, "b", "");
+    ds_string formatted = ds_format("%c", 'a');
+    TEST_ASSERT_TRUE(joined == a);
+    TEST_ASSERT_TRUE(replaced == a);
+    TEST_ASSERT_TRUE(formatted == a);
+
+    // Unfreezing cannot turn a singleton back into a freeable string
+    ds_unfreeze(a);
+    TEST_ASSERT_TRUE(ds_is_immortal(a));
+    ds_release(&a);
+    TEST_ASSERT_EQUAL_STRING("a", sub);
+
+    ds_release(&ab);
+    ds_release(&source);
+}
+
+void test_split_into_bytes_shares_singletons(void) {
+    ds_string text = ds_new("abcab");
+    size_t count = 0;
+    ds_string* parts = ds_split_length(text, NULL, 0, &count);
+    TEST_ASSERT_EQUAL_UINT(5, count);
+    TEST_ASSERT_TRUE(parts[0] == parts[3]);
+    TEST_ASSERT_TRUE(parts[1] == parts[4]);
+    TEST_ASSERT_EQUAL_STRING("c", parts[2]);
+    ds_free_split_result(parts, count);
+    ds_release(&text);
+}
+
+// ============================================================================
+// CONCURRENT BUILDER TESTS
+// ============================================================================
+
+typedef struct {
+    ds_concurrent_builder* cb;
+    int lines;
+} concurrent_writer_ctx;
+
+static void concurrent_writer(void* ctx, size_t task) {
+    concurrent_writer_ctx* writer = (concurrent_writer_ctx*)ctx;
+    char line[32];
+    for (int i = 0; i < writer->lines; i++) {
+        int len = snprintf(line, sizeof(line), "w%02u:%05d\n", (unsigned)task, i);
+        ds_concurrent_builder_append(writer->cb, line, (size_t)len);
+    }
+}
+
+void test_concurrent_builder_chaining_and_drain(void) {
+    ds_concurrent_builder* cb = ds_concurrent_builder_create(16);
+    ds_builder out = ds_builder_create();
+
+    ds_concurrent_builder_append(cb, "hello ", 6);
+    ds_concurrent_builder_append(cb, "concurrent ", 11); // Crosses into a second chunk
+    TEST_ASSERT_EQUAL_UINT(17, ds_concurrent_builder_drain(cb, out));
+    TEST_ASSERT_EQUAL_UINT(0, ds_concurrent_builder_drain(cb, out));
+
+    // Larger than a chunk: gets a chunk of its own
+    ds_concurrent_builder_append(cb, "world, in one piece!", 20);
+    ds_concurrent_builder_append(cb, "", 0);
+    TEST_ASSERT_EQUAL_UINT(20, ds_concurrent_builder_drain(cb, out));
+    TEST_ASSERT_EQUAL_STRING("hello concurrent world, in one piece!", ds_builder_cstr(out));
+
+    ds_concurrent_builder_append(cb, "tail", 4);
+    ds_string rest = ds_concurrent_builder_to_string(cb);
+    TEST_ASSERT_EQUAL_STRING("tail", rest);
+
+    ds_release(&rest);
+    ds_builder_release(&out);
+    ds_concurrent_builder_free(cb);
+}
+
+void test_concurrent_builder_parallel_writers(void) {
+    // Small chunks force frequent sealing and chaining under contention
+    concurrent_writer_ctx ctx = {ds_concurrent_builder_create(256), 2000};
+    ds_parallel_for(8, 8, concurrent_writer, &ctx);
+    ds_string all = ds_concurrent_builder_to_string(ctx.cb);
+
+    // Every line arrives whole and exactly once
+    const size_t line_len = 10;
+    TEST_ASSERT_EQUAL_UINT(8 * 2000 * line_len, ds_length(all));
+    int next_seq[8] = {0};
+    for (size_t pos = 0; pos < ds_length(all); pos += line_len) {
+        unsigned task;
+        int seq;
+        TEST_ASSERT_EQUAL_INT(2, sscanf(all + pos, "w%02u:%05d", &task, &seq));
+        TEST_ASSERT_EQUAL_CHAR('\n', all[pos + line_len - 1]);
+        TEST_ASSERT_TRUE(task < 8);
+        TEST_ASSERT_EQUAL_INT(next_seq[task], seq); // Per-writer order is kept
+        next_seq[task]++;
+    }
+
+    ds_release(&all);
+    ds_concurrent_builder_free(ctx.cb);
+}
+
+void test_queue_ownership_handoff(void) {
+    ds_spsc_queue* spsc = ds_spsc_queue_create(3); // Rounded up to 4
+    ds_string a = ds_new("alpha");
+    TEST_ASSERT_EQUAL_INT(1, ds_spsc_queue_push(spsc, a));
+    TEST_ASSERT_EQUAL_UINT(1, ds_refcount(a)); // The reference moved, it was not copied
+
+    ds_string batch[4] = {ds_new("b"), ds_new("c"), ds_new("d"), ds_new("e")};
+    TEST_ASSERT_EQUAL_UINT(3, ds_spsc_queue_push_batch(spsc, batch, 4));
+    TEST_ASSERT_EQUAL_INT(0, ds_spsc_queue_push(spsc, batch[3])); // Full: caller keeps it
+
+    ds_string out[4];
+    TEST_ASSERT_EQUAL_UINT(2, ds_spsc_queue_pop_batch(spsc, out, 2));
+    TEST_ASSERT_EQUAL_PTR(a, out[0]);
+    TEST_ASSERT_EQUAL_STRING("b", out[1]);
+    ds_release_array(out, 2);
+    TEST_ASSERT_EQUAL_INT(1, ds_spsc_queue_push(spsc, batch[3])); // Wraps around the ring
+    ds_spsc_queue_free(spsc); // Releases c, d and e
+
+    ds_mpsc_queue* mpsc = ds_mpsc_queue_create(4);
+    ds_string run[6];
+    for (int i = 0; i < 6; i++) run[i] = ds_format("item%d", i);
+    TEST_ASSERT_EQUAL_UINT(4, ds_mpsc_queue_push_batch(mpsc, run, 6));
+    TEST_ASSERT_EQUAL_INT(0, ds_mpsc_queue_push(mpsc, run[4]));
+
+    ds_string first;
+    TEST_ASSERT_EQUAL_INT(1, ds_mpsc_queue_pop(mpsc, &first));
+    TEST_ASSERT_EQUAL_STRING("item0", first);
+    ds_release(&first);
+    TEST_ASSERT_EQUAL_UINT(1, ds_mpsc_queue_push_batch(mpsc, run + 4, 2)); // Only one slot free
+    TEST_ASSERT_EQUAL_UINT(4, ds_mpsc_queue_pop_batch(mpsc, out, 4));
+    TEST_ASSERT_EQUAL_STRING("item1", out[0]);
+    TEST_ASSERT_EQUAL_STRING("item4", out[3]);
+    ds_release_array(out, 4);
+    TEST_ASSERT_EQUAL_INT(0, ds_mpsc_queue_pop(mpsc, &first));
+
+    TEST_ASSERT_EQUAL_INT(1, ds_mpsc_queue_push(mpsc, run[5]));
+    ds_mpsc_queue_free(mpsc); // Releases item5
+}
+
+#define QUEUE_PRODUCERS 4
+#define QUEUE_ITEMS 1000
+
+typedef struct {
+    ds_mpsc_queue* queue;
+    int received[QUEUE_PRODUCERS];
+    int in_order;
+} queue_test_ctx;
+
+static void queue_worker(void* arg, size_t task) {
+    queue_test_ctx* ctx = (queue_test_ctx*)arg;
+    if (task < QUEUE_PRODUCERS) {
+        // Odd producers push in batches of up to 8, even ones one at a time
+        ds_string pending[8];
+        int next = 0;
+        while (next < QUEUE_ITEMS) {
+            size_t want = (task & 1) ? 8 : 1;
+            if (want > (size_t)(QUEUE_ITEMS - next)) want = (size_t)(QUEUE_ITEMS - next);
+            for (size_t i = 0; i < want; i++) pending[i] = ds_format("%u:%d", (unsigned)task, next + (int)i);
+            size_t done = 0;
+            while (done < want) done += ds_mpsc_queue_push_batch(ctx->queue, pending + done, want - done);
+            next += (int)want;
+        }
+        return;
+    }
+
+    int total = 0;
+    ds_string out[16];
+    while (total < QUEUE_PRODUCERS * QUEUE_ITEMS) {
+        size_t n = ds_mpsc_queue_pop_batch(ctx->queue, out, 16);
+        for (size_t i = 0; i < n; i++) {
+            unsigned producer;
+            int seq;
+            if (sscanf(out[i], "%u:%d", &producer, &seq) != 2 || producer >= QUEUE_PRODUCERS ||
+                seq != ctx->received[producer]) {
+                ctx->in_order = 0;
+            } else {
+                ctx->received[producer]++;
+            }
+        }
+        ds_release_array(out, n);
+        total += (int)n;
+    }
+}
+
+void test_mpsc_queue_parallel_producers(void) {
+    queue_test_ctx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    // A small ring keeps threaded producers contending for slots; without
+    // DS_THREADS the tasks run one after another, so everything must fit
+    ctx.queue = ds_mpsc_queue_create(DS_THREADS ? 64 : QUEUE_PRODUCERS * QUEUE_ITEMS);
+    ctx.in_order = 1;
+
+    ds_parallel_for(QUEUE_PRODUCERS + 1, QUEUE_PRODUCERS + 1, queue_worker, &ctx);
+
+    TEST_ASSERT_TRUE(ctx.in_order); // Per-producer order survives interleaving
+    for (int p = 0; p < QUEUE_PRODUCERS; p++) {
+        TEST_ASSERT_EQUAL_INT(QUEUE_ITEMS, ctx.received[p]);
+    }
+    ds_mpsc_queue_free(ctx.queue);
+}
+
+#if DS_HAVE_WRITEV
+#define LOG_THREADS 4
+#define LOG_LINES 500
+
+static void log_producer(void* arg, size_t task) {
+    ds_log* log = (ds_log*)arg;
+    ds_log_writer* writer = ds_log_writer_create(log);
+    char padding[301];
+    memset(padding, '.', 300);
+    padding[300] = '\0';
+    for (int i = 0; i < LOG_LINES; i++) {
+        // Every 50th line is longer than the stack staging buffer
+        const char* extra = i % 50 == 0 ? padding : "";
+        while (!ds_log_printf(writer, "t%u:%04d%s\n", (unsigned)task, i, extra)) {
+            ds_log_flush(log); // Full ring: a real producer would drop, the test waits
+        }
+    }
+}
+
+void test_log_rings_and_flush(void) {
+    const char* path = "test_log.txt";
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    // A 1KB ring wraps often, exercising both the in-place and the staged path
+    ds_log* log = ds_log_create(fd, 1000);
+    ds_parallel_for(LOG_THREADS, LOG_THREADS, log_producer, log);
+
+    // A line that can never fit is dropped and counted, not waited on
+    char oversized[2048];
+    memset(oversized, 'x', sizeof(oversized));
+    ds_log_writer* writer = ds_log_writer_create(log);
+    size_t dropped = ds_log_dropped(log);
+    TEST_ASSERT_EQUAL_INT(0, ds_log_write(writer, oversized, sizeof(oversized)));
+    TEST_ASSERT_EQUAL_UINT(dropped + 1, ds_log_dropped(log));
+    ds_log_free(log);
+    close(fd);
+
+    FILE* f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    int next[LOG_THREADS] = {0};
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned task;
+        int seq;
+        TEST_ASSERT_EQUAL_INT(2, sscanf(line, "t%u:%04d", &task, &seq));
+        TEST_ASSERT_TRUE(task < LOG_THREADS);
+        TEST_ASSERT_EQUAL_INT(next[task], seq); // Lines are whole and in per-thread order
+        TEST_ASSERT_EQUAL_UINT(seq % 50 == 0 ? 308 : 8, strlen(line));
+        next[task]++;
+    }
+    fclose(f);
+    remove(path);
+    for (int t = 0; t < LOG_THREADS; t++) {
+        TEST_ASSERT_EQUAL_INT(LOG_LINES, next[t]);
+    }
+}
+#endif
+
+static void check_timestamp(int64_t nanos, ds_timestamp_format format, const char* expected) {
+    ds_builder sb = ds_builder_create();
+    TEST_ASSERT_TRUE(ds_builder_append_timestamp(sb, nanos, format));
+    TEST_ASSERT_EQUAL_STRING(expected, ds_builder_cstr(sb));
+    ds_builder_release(&sb);
+}
+
+void test_builder_append_timestamp(void) {
+    check_timestamp(0, DS_TIMESTAMP_SECONDS, "1970-01-01T00:00:00Z");
+    check_timestamp(1700000000123456789LL, DS_TIMESTAMP_MILLIS, "2023-11-14T22:13:20.123Z");
+    check_timestamp(1700000000123456789LL, DS_TIMESTAMP_MICROS, "2023-11-14T22:13:20.123456Z");
+    check_timestamp(1700000000000000007LL, DS_TIMESTAMP_NANOS, "2023-11-14T22:13:20.000000007Z"); // Cached prefix
+    check_timestamp(1709208000LL * 1000000000, DS_TIMESTAMP_SECONDS, "2024-02-29T12:00:00Z");
+    check_timestamp(-1, DS_TIMESTAMP_NANOS, "1969-12-31T23:59:59.999999999Z");
+    check_timestamp(INT64_MAX, DS_TIMESTAMP_NANOS, "2262-04-11T23:47:16.854775807Z");
+    check_timestamp(INT64_MIN, DS_TIMESTAMP_NANOS, "1677-09-21T00:12:43.145224192Z");
+
+    // Agree with gmtime/strftime across a spread of seconds, appending to one builder
+    ds_builder sb = ds_builder_create();
+    srand(94);
+    for (int i = 0; i < 2000; i++) {
+        time_t t = (time_t)(((int64_t)rand() << 16 ^ rand()) % 4102444800LL); // 1970..2100
+        char expected[32];
+        TEST_ASSERT_EQUAL_UINT(20, strftime(expected, sizeof(expected), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t)));
+        size_t start = ds_builder_length(sb);
+        TEST_ASSERT_TRUE(ds_builder_append_timestamp(sb, (int64_t)t * 1000000000, DS_TIMESTAMP_SECONDS));
+        TEST_ASSERT_EQUAL_STRING(expected, ds_builder_cstr(sb) + start);
+    }
+    ds_builder_release(&sb);
+}
+
+typedef struct {
+    int64_t seconds[2];
+    const char* expected[2];
+    int wrong;
+} timestamp_worker;
+
+static void* timestamp_worker_run(void* arg) {
+    timestamp_worker* w = arg;
+    ds_builder sb = ds_builder_create();
+    for (int i = 0; i < 20000; i++) {
+        ds_builder_clear(sb);
+        ds_builder_append_timestamp(sb, w->seconds[i & 1] * 1000000000, DS_TIMESTAMP_SECONDS);
+        if (strcmp(ds_builder_cstr(sb), w->expected[i & 1]) != 0) w->wrong++;
+    }
+    ds_builder_release(&sb);
+    return NULL;
+}
+
+void test_timestamp_cache_per_thread(void) {
+    // Separate builders on separate threads must not share a seconds cache, with or without DS_THREADS
+    timestamp_worker workers[2] = {
+        {{1700000000, 1700000001}, {"2023-11-14T22:13:20Z", "2023-11-14T22:13:21Z"}, 0},
+        {{800, 801}, {"1970-01-01T00:13:20Z", "1970-01-01T00:13:21Z"}, 0},
+    };
+    pthread_t threads[2];
+    for (int t = 0; t < 2; t++) TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[t], NULL, timestamp_worker_run, &workers[t]));
+    for (int t = 0; t < 2; t++) pthread_join(threads[t], NULL);
+    TEST_ASSERT_EQUAL_INT(0, workers[0].wrong);
+    TEST_ASSERT_EQUAL_INT(0, workers[1].wrong);
+}
+
+// Bitwise reference CRC32C
+static uint32_t crc32c_reference(const unsigned char* p, size_t length) {
+    uint32_t crc = 0xFFFFFFFFu;
+    while (length--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+    }
+    return ~crc;
+}
+
+void test_crc32c(void) {
+    ds_string check = ds_new("123456789");
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283u, ds_crc32c(check));
+    ds_release(&check);
+    TEST_ASSERT_EQUAL_HEX32(0, ds_crc32c_update(0, NULL, 0));
+
+    // Sizes around the interleaved lane boundaries, at every alignment
+    size_t size = 3 * 8192 * 2 + 1000;
+    unsigned char* data = (unsigned char*)malloc(size + 8);
+    srand(95);
+    for (size_t i = 0; i < size + 8; i++) data[i] = (unsigned char)rand();
+    const size_t lengths[] = {0, 1, 7, 8, 255, 256, 767, 768, 769, 3 * 256 * 5 + 3, 24575, 24576, 24577, size};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        for (size_t offset = 0; offset < 8; offset++) {
+            uint32_t expected = crc32c_reference(data + offset, lengths[i]);
+            TEST_ASSERT_EQUAL_HEX32(expected, ds_crc32c_update(0, data + offset, lengths[i]));
+            size_t half = lengths[i] / 3;
+            uint32_t split = ds_crc32c_update(ds_crc32c_update(0, data + offset, half), data + offset + half,
+                                              lengths[i] - half);
+            TEST_ASSERT_EQUAL_HEX32(expected, split);
+        }
+    }
+    free(data);
+}
+
+void test_builder_crc32c_incremental(void) {
+    ds_builder sb = ds_builder_create();
+    TEST_ASSERT_EQUAL_HEX32(0, ds_builder_crc32c(sb));
+    ds_builder_append(sb, "12345");
+    TEST_ASSERT_EQUAL_HEX32(ds_crc32c_update(0, "12345", 5), ds_builder_crc32c(sb));
+    ds_builder_append(sb, "6789");
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283u, ds_builder_crc32c(sb)); // Only "6789" was read
+
+    ds_builder_append(sb, "!"); // Edits at or past the checksummed prefix keep it
+    ds_builder_insert(sb, 0, ">"); // Editing inside it starts over
+    TEST_ASSERT_EQUAL_HEX32(ds_crc32c_update(0, ">123456789!", 11), ds_builder_crc32c(sb));
+    ds_builder_remove_range(sb, 0, 1);
+    ds_builder_replace_range(sb, 9, 10, "?");
+    TEST_ASSERT_EQUAL_HEX32(ds_crc32c_update(0, "123456789?", 10), ds_builder_crc32c(sb));
+    ds_builder_clear(sb);
+    TEST_ASSERT_EQUAL_HEX32(0, ds_builder_crc32c(sb));
+    ds_builder_release(&sb);
+}
+
+static ds_string build_tracked(const char* const* pieces, size_t count) {
+    ds_builder sb = ds_builder_create();
+    ds_builder_track_text(sb);
+    for (size_t i = 0; i < count; i++) ds_builder_append_length(sb, pieces[i], strlen(pieces[i]));
+    ds_string result = ds_builder_to_string(sb);
+    ds_builder_release(&sb);
+    return result;
+}
+
+void test_builder_track_text(void) {
+    const char* ascii[] = {"user:", "1234", ":profile"};
+    ds_string key = build_tracked(ascii, 3);
+    ds_string plain = ds_new("user:1234:profile");
+    TEST_ASSERT_TRUE(*ds_flags(key) & DS_FLAG_HASHED);
+    TEST_ASSERT_TRUE(*ds_flags(key) & DS_FLAG_ASCII);
+    TEST_ASSERT_EQUAL_UINT64(ds_hash(plain), ds_hash(key)); // Read from the stamped slot
+    TEST_ASSERT_TRUE(ds_is_ascii(key));
+    TEST_ASSERT_TRUE(ds_is_valid_utf8(key));
+    for (size_t i = 1; i <= DS_SIMD_PADDING; i++) {
+        TEST_ASSERT_EQUAL_CHAR(0, key[ds_length(key) + i]); // The slot sits past the padding
+    }
+    ds_release(&key);
+    ds_release(&plain);
+
+    const char* euro_split[] = {"price \xE2\x82", "\xAC" "5"}; // Sequence split across appends
+    ds_string euro = build_tracked(euro_split, 2);
+    TEST_ASSERT_FALSE(ds_is_ascii(euro));
+    TEST_ASSERT_TRUE(*ds_flags(euro) & DS_FLAG_UTF8);
+    ds_release(&euro);
+
+    const char* truncated[] = {"ok", "\xE2\x82"};
+    ds_string cut = build_tracked(truncated, 2);
+    TEST_ASSERT_FALSE(*ds_flags(cut) & DS_FLAG_UTF8);
+    TEST_ASSERT_FALSE(ds_is_valid_utf8(cut));
+    ds_release(&cut);
+
+    // A mid-buffer edit restarts tracking; the stamped hash still matches the content
+    ds_builder sb = ds_builder_create();
+    ds_builder_track_text(sb);
+    ds_builder_append(sb, "abcdef");
+    ds_builder_insert(sb, 3, "\xC3\xA9");
+    ds_builder_append_format(sb, "-%d", 42);
+    ds_string edited = ds_builder_to_string(sb);
+    ds_builder_release(&sb);
+    TEST_ASSERT_EQUAL_STRING("abc\xC3\xA9" "def-42", edited);
+    TEST_ASSERT_EQUAL_UINT64(ds_hash_bytes(edited, ds_length(edited)), ds_hash(edited));
+    TEST_ASSERT_TRUE(*ds_flags(edited) & DS_FLAG_UTF8);
+    TEST_ASSERT_FALSE(*ds_flags(edited) & DS_FLAG_ASCII);
+    ds_release(&edited);
+}
+
+void test_utf8_validation(void) {
+    const char* valid[] = {"", "plain", "\xC2\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xF4\x8F\xBF\xBF"};
+    const char* invalid[] = {"\x80", "\xC0\xAF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80",
+                             "abcdefghij\xE2\x82"};
+    for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+        ds_string str = ds_new(valid[i]);
+        TEST_ASSERT_TRUE_MESSAGE(ds_is_valid_utf8(str), valid[i]);
+        ds_release(&str);
+    }
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        ds_string str = ds_new(invalid[i]);
+        TEST_ASSERT_FALSE(ds_is_valid_utf8(str));
+        TEST_ASSERT_FALSE(ds_is_ascii(str));
+        ds_release(&str);
+    }
+}
+
+typedef struct {
+    size_t next_offset;
+    size_t count;
+    int contiguous;
+    size_t lengths[512];
+    uint64_t hashes[512];
+    size_t stop_after;
+} chunk_log;
+
+static int record_chunk(void* ctx, const char* chunk, size_t offset, size_t length) {
+    chunk_log* log = (chunk_log*)ctx;
+    if (offset != log->next_offset) log->contiguous = 0;
+    log->next_offset = offset + length;
+    if (log->count < 512) {
+        log->lengths[log->count] = length;
+        log->hashes[log->count] = ds_rolling_hash_bytes(chunk, length);
+    }
+    log->count++;
+    return log->stop_after && log->count == log->stop_after;
+}
+
+void test_cdc_chunks(void) {
+    const size_t size = 1 << 20;
+    char* data = (char*)malloc(size + 100);
+    srand(97);
+    for (size_t i = 0; i < size + 100; i++) data[i] = (char)rand();
+    ds_string blob = ds_new_length(data + 100, size);
+
+    static chunk_log original, shifted;
+    memset(&original, 0, sizeof(original));
+    original.contiguous = 1;
+    size_t chunks = ds_cdc_chunks(blob, 1024, 4096, 16384, record_chunk, &original);
+    TEST_ASSERT_EQUAL_UINT(original.count, chunks);
+    TEST_ASSERT_TRUE(original.contiguous);
+    TEST_ASSERT_EQUAL_UINT(size, original.next_offset); // Views cover the whole string
+    for (size_t i = 0; i + 1 < chunks; i++) {
+        TEST_ASSERT_TRUE(original.lengths[i] >= 1024 && original.lengths[i] <= 16384);
+    }
+    TEST_ASSERT_TRUE(size / chunks > 2048 && size / chunks < 8192);
+
+    // Prepending 100 bytes only disturbs the first chunk or two
+    memset(&shifted, 0, sizeof(shifted));
+    shifted.contiguous = 1;
+    ds_cdc_chunks_length(data, size + 100, 1024, 4096, 16384, record_chunk, &shifted);
+    size_t shared = 0;
+    for (size_t i = 0; i < original.count && i < 512; i++) {
+        for (size_t j = 0; j < shifted.count && j < 512; j++) {
+            if (original.hashes[i] == shifted.hashes[j] && original.lengths[i] == shifted.lengths[j]) {
+                shared++;
+                break;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(shared + 2 >= original.count);
+
+    chunk_log stopped;
+    memset(&stopped, 0, sizeof(stopped));
+    stopped.stop_after = 3;
+    TEST_ASSERT_EQUAL_UINT(3, ds_cdc_chunks(blob, 1024, 4096, 16384, record_chunk, &stopped));
+    TEST_ASSERT_EQUAL_UINT(4, ds_cdc_next("tiny", 4, 1024, 4096, 16384)); // Shorter than min_size: one chunk
+
+    ds_release(&blob);
+    free(data);
+}
+
+void test_rolling_hash(void) {
+    const char* text = "the quick brown fox jumps over the lazy dog; the quick brown cat";
+    size_t length = strlen(text);
+    const size_t window = 9; // "the quick"
+
+    ds_rolling_hash rh;
+    uint64_t hash = ds_rolling_hash_init(&rh, text, window);
+    uint64_t needle = ds_rolling_hash_bytes("the quick", window);
+    size_t matches = hash == needle;
+    for (size_t i = window; i < length; i++) {
+        hash = ds_rolling_hash_roll(&rh, text[i - window], text[i]);
+        TEST_ASSERT_EQUAL_UINT64(ds_rolling_hash_bytes(text + i + 1 - window, window), hash);
+        if (hash == needle) matches++;
+    }
+    TEST_ASSERT_EQUAL_UINT(2, matches);
+
+    // Zero bytes still shift the hash
+    TEST_ASSERT_TRUE(ds_rolling_hash_bytes("\0", 1) != ds_rolling_hash_bytes("\0\0", 2));
+}
+
+/**
+ * @brief Build a pseudo-random document of lowercase words
+ */
+static ds_string similarity_doc(uint32_t seed, size_t words) {
+    ds_builder sb = ds_builder_create();
+    for (size_t w = 0; w < words; w++) {
+        seed = seed * 1103515245u + 12345u;
+        size_t letters = 3 + (seed >> 16) % 6;
+        for (size_t i = 0; i < letters; i++) {
+            seed = seed * 1103515245u + 12345u;
+            ds_builder_append_char(sb, 'a' + (seed >> 16) % 26);
+        }
+        ds_builder_append_char(sb, ' ');
+    }
+    ds_string doc = ds_builder_to_string(sb);
+    ds_builder_release(&sb);
+    return doc;
+}
+
+void test_simhash_minhash(void) {
+    ds_string doc = similarity_doc(1, 120);
+    ds_string edited = ds_replace(doc, " ", "  "); // First space doubled, everything else intact
+    ds_string other = similarity_doc(2, 120);
+
+    TEST_ASSERT_EQUAL_UINT64(ds_simhash(doc, 5), ds_simhash(doc, 5));
+    int near = ds_simhash_distance(ds_simhash(doc, 5), ds_simhash(edited, 5));
+    int far = ds_simhash_distance(ds_simhash(doc, 5), ds_simhash(other, 5));
+    TEST_ASSERT_TRUE(near <= 6);
+    TEST_ASSERT_TRUE(far >= 16);
+    TEST_ASSERT_EQUAL_INT(64, ds_simhash_distance(0, UINT64_MAX));
+
+    uint64_t a[128], b[128], c[128];
+    ds_minhash(doc, 5, 128, a);
+    ds_minhash(edited, 5, 128, b);
+    ds_minhash(other, 5, 128, c);
+    TEST_ASSERT_TRUE(ds_minhash_similarity(a, b, 128) > 0.9);
+    TEST_ASSERT_TRUE(ds_minhash_similarity(a, c, 128) < 0.1);
+    TEST_ASSERT_TRUE(ds_minhash_similarity(a, a, 128) == 1.0);
+
+    // Shorter than a shingle: the whole string is the one shingle
+    ds_string tiny = ds_new("ab");
+    ds_string empty = ds_new("");
+    ds_minhash(tiny, 5, 4, a);
+    ds_minhash(tiny, 2, 4, b);
+    TEST_ASSERT_EQUAL_UINT64_ARRAY(a, b, 4);
+    ds_minhash(empty, 5, 4, c);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, c[0]);
+    TEST_ASSERT_EQUAL_UINT64(0, ds_simhash(empty, 5));
+
+    ds_release(&doc);
+    ds_release(&edited);
+    ds_release(&other);
+    ds_release(&tiny);
+    ds_release(&empty);
+}
+
+typedef struct {
+    size_t pairs[16][2];
+    size_t count;
+} lsh_pairs;
+
+static int collect_lsh_pair(void* ctx, size_t a, size_t b) {
+    lsh_pairs* found = (lsh_pairs*)ctx;
+    if (found->count < 16) {
+        found->pairs[found->count][0] = a;
+        found->pairs[found->count][1] = b;
+    }
+    found->count++;
+    return 0;
+}
+
+void test_lsh_index_pairs(void) {
+    // Documents 0/3 and 2/5 are near-duplicates; the rest are unrelated
+    enum { DOCS = 6, K = 64, BANDS = 16 };
+    uint32_t seeds[DOCS] = {10, 11, 12, 10, 13, 12};
+    uint64_t signatures[DOCS * K];
+    for (size_t i = 0; i < DOCS; i++) {
+        ds_string doc = similarity_doc(seeds[i], 150);
+        if (i >= 3) {
+            ds_string edited = ds_append(doc, "postscript");
+            ds_release(&doc);
+            doc = edited;
+        }
+        ds_minhash(doc, 5, K, signatures + i * K);
+        ds_release(&doc);
+    }
+
+    ds_lsh_index* lsh = ds_lsh_index_build(signatures, DOCS, K, BANDS);
+    TEST_ASSERT_NOT_NULL(lsh);
+
+    lsh_pairs found;
+    found.count = 0;
+    TEST_ASSERT_EQUAL_UINT(2, ds_lsh_index_pairs(lsh, collect_lsh_pair, &found));
+    TEST_ASSERT_EQUAL_UINT(2, found.count); // Reported once, though they collide in many bands
+    TEST_ASSERT_TRUE(found.pairs[0][0] == 0 || found.pairs[0][0] == 2);
+    TEST_ASSERT_EQUAL_UINT(found.pairs[0][0] + 3, found.pairs[0][1]);
+    TEST_ASSERT_EQUAL_UINT(found.pairs[1][0] + 3, found.pairs[1][1]);
+    TEST_ASSERT_TRUE(found.pairs[0][0] != found.pairs[1][0]);
+
+    size_t candidates[DOCS];
+    size_t n = ds_lsh_index_query(lsh, signatures + 2 * K, candidates, DOCS);
+    TEST_ASSERT_EQUAL_UINT(2, n);
+    TEST_ASSERT_TRUE((candidates[0] == 2 && candidates[1] == 5) || (candidates[0] == 5 && candidates[1] == 2));
+    TEST_ASSERT_EQUAL_UINT(1, ds_lsh_index_query(lsh, signatures + 2 * K, candidates, 1));
+
+    ds_lsh_index_free(lsh);
+
+    ds_lsh_index* none = ds_lsh_index_build(NULL, 0, K, BANDS);
+    TEST_ASSERT_NOT_NULL(none);
+    TEST_ASSERT_EQUAL_UINT(0, ds_lsh_index_pairs(none, collect_lsh_pair, &found));
+    TEST_ASSERT_EQUAL_UINT(0, ds_lsh_index_query(none, signatures, candidates, DOCS));
+    ds_lsh_index_free(none);
+}
+
+static int compare_ds_strings(const void* a, const void* b) {
+    ds_string x = *(const ds_string*)a, y = *(const ds_string*)b;
+    size_t x_len = ds_length(x), y_len = ds_length(y);
+    int result = memcmp(x, y, x_len < y_len ? x_len : y_len);
+    return result ? result : (x_len > y_len) - (x_len < y_len);
+}
+
+void test_frontcoded_dict(void) {
+    enum { URLS = 300 };
+    const char* hosts[] = {"https://example.com/", "https://example.org/docs/", "http://a.io/"};
+    ds_string urls[URLS];
+    size_t raw_bytes = 0;
+    for (size_t i = 0; i < URLS; i++) {
+        char text[96];
+        snprintf(text, sizeof(text), "%sitems/%03zu/view", hosts[i % 3], (i * 37) % 250); // Some duplicates
+        urls[i] = ds_new(text);
+        raw_bytes += ds_length(urls[i]);
+    }
+    qsort(urls, URLS, sizeof(ds_string), compare_ds_strings);
+
+    ds_frontcoded_dict* dict = ds_frontcoded_dict_build(urls, URLS);
+    TEST_ASSERT_NOT_NULL(dict);
+    TEST_ASSERT_EQUAL_UINT(URLS, ds_frontcoded_dict_count(dict));
+    TEST_ASSERT_TRUE(ds_frontcoded_dict_memory(dict) < raw_bytes / 2);
+
+    char buffer[96];
+    for (size_t i = 0; i < URLS; i++) {
+        size_t first = i;
+        while (first > 0 && ds_compare(urls[first - 1], urls[i]) == 0) first--;
+        TEST_ASSERT_EQUAL_UINT(first, ds_frontcoded_dict_lookup(dict, urls[i], ds_length(urls[i])));
+
+        ds_string decoded = ds_frontcoded_dict_get(dict, i);
+        TEST_ASSERT_EQUAL_STRING(urls[i], decoded);
+        TEST_ASSERT_EQUAL_UINT(ds_length(urls[i]), ds_length(decoded));
+        ds_release(&decoded);
+        TEST_ASSERT_EQUAL_UINT(ds_length(urls[i]), ds_frontcoded_dict_copy(dict, i, buffer, sizeof(buffer)));
+        TEST_ASSERT_EQUAL_STRING(urls[i], buffer);
+    }
+    TEST_ASSERT_EQUAL_UINT(ds_length(urls[0]), ds_frontcoded_dict_copy(dict, 0, buffer, 6));
+    TEST_ASSERT_EQUAL_STRING("http:", buffer);
+
+    // Lower bounds against a linear scan, for keys between, before, after and inside entries
+    const char* probes[] = {"", "a", "http", "http://a.io/items/", "https://example.com/items/100",
+                            "https://example.com/items/100/view!", "https://example.org/docs/items/249/view",
+                            "https://example.org/docs/items/249/viex", "zzz"};
+    for (size_t p = 0; p < sizeof(probes) / sizeof(probes[0]); p++) {
+        ds_string key = ds_new(probes[p]);
+        size_t expected = 0;
+        while (expected < URLS && compare_ds_strings(&urls[expected], &key) < 0) expected++;
+        TEST_ASSERT_EQUAL_UINT(expected, ds_frontcoded_dict_lower_bound(dict, key, ds_length(key)));
+        ds_release(&key);
+    }
+    TEST_ASSERT_EQUAL_UINT(SIZE_MAX, ds_frontcoded_dict_lookup(dict, "https://example.com/items/", 26));
+    TEST_ASSERT_EQUAL_UINT(SIZE_MAX, ds_frontcoded_dict_lookup(dict, "zzz", 3));
+
+    size_t first;
+    size_t matches = ds_frontcoded_dict_prefix_range(dict, "https://example.org/", 20, &first);
+    TEST_ASSERT_EQUAL_UINT(URLS / 3, matches);
+    for (size_t i = first; i < first + matches; i++) {
+        TEST_ASSERT_TRUE(ds_starts_with(urls[i], "https://example.org/"));
+    }
+    TEST_ASSERT_EQUAL_UINT(URLS, ds_frontcoded_dict_prefix_range(dict, "", 0, &first));
+    TEST_ASSERT_EQUAL_UINT(0, ds_frontcoded_dict_prefix_range(dict, "ftp", 3, NULL));
+    ds_frontcoded_dict_free(dict);
+
+    ds_frontcoded_dict* empty = ds_frontcoded_dict_build(NULL, 0);
+    TEST_ASSERT_EQUAL_UINT(SIZE_MAX, ds_frontcoded_dict_lookup(empty, "a", 1));
+    TEST_ASSERT_EQUAL_UINT(0, ds_frontcoded_dict_prefix_range(empty, "", 0, NULL));
+    ds_frontcoded_dict_free(empty);
+
+    ds_release_array(urls, URLS);
+}
+
+void test_inverted_index_search(void) {
+    ds_string docs[] = {ds_new("The quick brown fox"), ds_new("A QUICK red fox, jumping over the lazy dog"),
+                        ds_new("Caf\xC3\xA9-au-lait and croissants"),
+                        ds_new("tokens-that-straddle-sixteen-byte-boundaries: quick.quick;quick")};
+    ds_inverted_index* index = ds_inverted_index_build(docs, 4, 1);
+    TEST_ASSERT_NOT_NULL(index);
+    TEST_ASSERT_EQUAL_UINT(4, ds_inverted_index_doc_count(index));
+
+    size_t hits[8];
+    TEST_ASSERT_EQUAL_UINT(3, ds_inverted_index_search(index, "quick", 5, DS_INDEX_AND, hits, 8));
+    TEST_ASSERT_EQUAL_UINT(0, hits[0]);
+    TEST_ASSERT_EQUAL_UINT(1, hits[1]);
+    TEST_ASSERT_EQUAL_UINT(3, hits[2]);
+    TEST_ASSERT_EQUAL_UINT(2, ds_inverted_index_search(index, "Fox QUICK", 9, DS_INDEX_AND, hits, 8));
+    TEST_ASSERT_EQUAL_UINT(0, ds_inverted_index_search(index, "fox missing", 11, DS_INDEX_AND, hits, 8));
+    TEST_ASSERT_EQUAL_UINT(3, ds_inverted_index_search(index, "fox missing caf\xC3\xA9", 17, DS_INDEX_OR, hits, 8));
+    TEST_ASSERT_EQUAL_UINT(2, hits[2]);
+    TEST_ASSERT_EQUAL_UINT(1, ds_inverted_index_search(index, "straddle byte", 13, DS_INDEX_AND, hits, 8));
+    TEST_ASSERT_EQUAL_UINT(3, hits[0]);
+    TEST_ASSERT_EQUAL_UINT(0, ds_inverted_index_search(index, " ,;", 3, DS_INDEX_OR, hits, 8));
+    TEST_ASSERT_EQUAL_UINT(3, ds_inverted_index_doc_freq(index, "QUICK", 5));
+    TEST_ASSERT_EQUAL_UINT(1, ds_inverted_index_doc_freq(index, "lait", 4));
+    TEST_ASSERT_EQUAL_UINT(0, ds_inverted_index_doc_freq(index, "qu", 2));
+    ds_inverted_index_free(index);
+    ds_release_array(docs, 4);
+
+    // Enough documents for several tokenizing tasks and multi-block posting lists
+    enum { DOCS = 6000, WORDS = 40 };
+    static uint64_t present[DOCS]; // Bit w set when word w is in the document
+    ds_string* corpus = (ds_string*)malloc(DOCS * sizeof(ds_string));
+    uint32_t seed = 7;
+    for (size_t d = 0; d < DOCS; d++) {
+        ds_builder sb = ds_builder_create();
+        present[d] = 0;
+        for (int k = 0; k < 6; k++) {
+            seed = seed * 1103515245u + 12345u;
+            unsigned w = (seed >> 16) % WORDS;
+            w = w * w / WORDS; // Skewed: low words are frequent
+            present[d] |= 1ULL << w;
+            ds_builder_append(sb, (seed >> 8) & 1 ? "W" : "w");
+            ds_builder_append_long(sb, (long)w);
+            ds_builder_append(sb, k % 3 ? " " : ",\t");
+        }
+        if (d % 2 == 0) {
+            ds_builder_append(sb, "even");
+            present[d] |= 1ULL << WORDS;
+        }
+        corpus[d] = ds_builder_to_string(sb);
+        ds_builder_release(&sb);
+    }
+    index = ds_inverted_index_build(corpus, DOCS, 4);
+    TEST_ASSERT_EQUAL_UINT(DOCS / 2, ds_inverted_index_doc_freq(index, "even", 4));
+
+    size_t* found = (size_t*)malloc(DOCS * sizeof(size_t));
+    const char* queries[] = {"w0 w1", "w3 even", "w20 w39", "w0 w1 w2"};
+    for (size_t q = 0; q < 4; q++) {
+        for (int op = DS_INDEX_AND; op <= DS_INDEX_OR; op++) {
+            // Words of the query as a bitmask
+            uint64_t want = 0;
+            ds_string query = ds_new(queries[q]);
+            size_t count = 0;
+            ds_string* parts = ds_split(query, " ", &count);
+            for (size_t i = 0; i < count; i++) {
+                want |= strcmp(parts[i], "even") == 0 ? 1ULL << WORDS : 1ULL << atoi(parts[i] + 1);
+            }
+            ds_free_split_result(parts, count);
+
+            size_t expected = 0;
+            size_t total = ds_inverted_index_search(index, query, ds_length(query), (ds_index_op)op, found, DOCS);
+            for (size_t d = 0; d < DOCS; d++) {
+                int match = op == DS_INDEX_AND ? (present[d] & want) == want : (present[d] & want) != 0;
+                if (!match) continue;
+                TEST_ASSERT_TRUE(expected < total);
+                TEST_ASSERT_EQUAL_UINT(d, found[expected]);
+                expected++;
+            }
+            TEST_ASSERT_EQUAL_UINT(expected, total);
+            ds_release(&query);
+        }
+    }
+
+    free(found);
+    ds_inverted_index_free(index);
+    ds_release_array(corpus, DOCS);
+    free(corpus);
+}
+
+void test_inverted_index_file(void) {
+    ds_string docs[] = {ds_new("alpha beta"), ds_new("beta gamma"), ds_new("gamma alpha beta")};
+    ds_inverted_index* index = ds_inverted_index_build(docs, 3, 2);
+    const char* path = "test_index.dsi";
+    TEST_ASSERT_TRUE(ds_inverted_index_save(index, path));
+    ds_inverted_index_free(index);
+    ds_release_array(docs, 3);
+
+    ds_inverted_index* mapped = ds_inverted_index_load_mmap(path);
+    TEST_ASSERT_NOT_NULL(mapped);
+    TEST_ASSERT_EQUAL_UINT(3, ds_inverted_index_term_count(mapped));
+    size_t hits[3];
+    TEST_ASSERT_EQUAL_UINT(2, ds_inverted_index_search(mapped, "alpha beta", 10, DS_INDEX_AND, hits, 3));
+    TEST_ASSERT_EQUAL_UINT(0, hits[0]);
+    TEST_ASSERT_EQUAL_UINT(2, hits[1]);
+    TEST_ASSERT_EQUAL_UINT(3, ds_inverted_index_search(mapped, "alpha gamma", 11, DS_INDEX_OR, hits, 3));
+    ds_inverted_index_free(mapped);
+
+    // Truncated files are rejected
+    FILE* f = fopen(path, "r+b");
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    char* bytes = (char*)malloc((size_t)size);
+    f = fopen(path, "rb");
+    TEST_ASSERT_EQUAL_UINT((size_t)size, fread(bytes, 1, (size_t)size, f));
+    fclose(f);
+    f = fopen(path, "wb");
+    fwrite(bytes, 1, (size_t)size - 8, f);
+    fclose(f);
+    free(bytes);
+    TEST_ASSERT_NULL(ds_inverted_index_load_mmap(path));
+
+    // A term claiming postings in blocks the file does not have
+    uint64_t crafted[11] = {0, 1000000, 1, 0, 0, 0, 0, 0, 0, 1000000, 0};
+    memcpy(crafted, "DSINVIX1", 8);
+    f = fopen(path, "wb");
+    fwrite(crafted, sizeof(crafted), 1, f);
+    fclose(f);
+    TEST_ASSERT_NULL(ds_inverted_index_load_mmap(path));
+    remove(path);
+
+    ds_inverted_index* empty = ds_inverted_index_build(NULL, 0, 1);
+    TEST_ASSERT_NOT_NULL(empty);
+    TEST_ASSERT_EQUAL_UINT(0, ds_inverted_index_search(empty, "alpha", 5, DS_INDEX_OR, hits, 3));
+    ds_inverted_index_free(empty);
+}
+
 void test(void) {
     UNITY_BEGIN();
 
@@ -2036,6 +3898,7 @@ void test(void) {
     RUN_TEST(test_multiple_retains_releases);
     RUN_TEST(test_shared_string_immutability);
     RUN_TEST(test_release_null_safety);
+    RUN_TEST(test_retain_release_array);
     // RUN_TEST(test_retain_null_safety); // removed - NULL inputs now cause assertions
 
     // StringBuilder state transitions (second priority)
@@ -2108,6 +3971,7 @@ void test(void) {
     RUN_TEST(test_ds_substring);
     RUN_TEST(test_ds_replace_separate);
     RUN_TEST(test_ds_free_split_result);
+    RUN_TEST(test_split_packed);
     RUN_TEST(test_ds_refcount);
     RUN_TEST(test_ds_is_shared);
     RUN_TEST(test_ds_is_empty);
@@ -2136,6 +4000,96 @@ void test(void) {
     RUN_TEST(test_stringbuilder_edge_cases);
     RUN_TEST(test_stringbuilder_combined_operations);
 
+    // Fuzzy matching tests
+    RUN_TEST(test_edit_distance);
+    RUN_TEST(test_fuzzy_index);
+    RUN_TEST(test_fuzzy_index_parallel_build);
+
+    // Adaptive radix tree tests
+    RUN_TEST(test_art_insert_lookup);
+    RUN_TEST(test_art_longest_prefix);
+    RUN_TEST(test_art_ordered_iteration);
+
+    // Text index tests
+    RUN_TEST(test_text_index_count_locate);
+    RUN_TEST(test_text_index_matches_naive_search);
+
+    // String table tests
+    RUN_TEST(test_table_save_load_mmap);
+    RUN_TEST(test_table_rejects_invalid_file);
+
+    // Freeze tests
+    RUN_TEST(test_freeze_unfreeze);
+    RUN_TEST(test_freeze_array);
+    RUN_TEST(test_unfreeze_leaves_other_immortals);
+
+    // Compressed vector tests
+    RUN_TEST(test_compressed_vec_roundtrip);
+    RUN_TEST(test_compressed_vec_find);
+
+    // Dictionary column tests
+    RUN_TEST(test_dict_column_append_and_filter);
+    RUN_TEST(test_dict_column_widening_and_parallel_build);
+
+    // Length variant tests
+    RUN_TEST(test_length_variants);
+    RUN_TEST(test_length_variants_embedded_nulls);
+
+    // Allocator tests
+    RUN_TEST(test_string_with_allocator);
+    RUN_TEST(test_builder_with_allocator);
+
+    // Header layout tests
+    RUN_TEST(test_compact_header_sizes);
+    RUN_TEST(test_builder_result_compacted);
+
+    // SIMD padding tests
+    RUN_TEST(test_simd_padding_contract);
+
+    // Small string singleton tests
+    RUN_TEST(test_small_string_singletons);
+    RUN_TEST(test_split_into_bytes_shares_singletons);
+
+    // Concurrent builder tests
+    RUN_TEST(test_concurrent_builder_chaining_and_drain);
+    RUN_TEST(test_concurrent_builder_parallel_writers);
+
+    // Queue tests
+    RUN_TEST(test_queue_ownership_handoff);
+    RUN_TEST(test_mpsc_queue_parallel_producers);
+
+    // Logging tests
+#if DS_HAVE_WRITEV
+    RUN_TEST(test_log_rings_and_flush);
+#endif
+
+    // Timestamp tests
+    RUN_TEST(test_builder_append_timestamp);
+    RUN_TEST(test_timestamp_cache_per_thread);
+
+    // Checksum tests
+    RUN_TEST(test_crc32c);
+    RUN_TEST(test_builder_crc32c_incremental);
+
+    // Text tracking tests
+    RUN_TEST(test_builder_track_text);
+    RUN_TEST(test_utf8_validation);
+
+    // Chunking tests
+    RUN_TEST(test_cdc_chunks);
+    RUN_TEST(test_rolling_hash);
+
+    // Similarity
+    RUN_TEST(test_simhash_minhash);
+    RUN_TEST(test_lsh_index_pairs);
+
+    // Front-coded dictionary
+    RUN_TEST(test_frontcoded_dict);
+
+    // Inverted index
+    RUN_TEST(test_inverted_index_search);
+    RUN_TEST(test_inverted_index_file);
+
     UNITY_END();
 }
 
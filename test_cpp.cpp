@@ -0,0 +1,145 @@
+#define DS_IMPLEMENTATION
+#include "dynamic_string.hpp"
+#include "libs/unity/unity.h"
+
+#include <sstream>
+#include <unordered_set>
+#include <utility>
+
+// ============================================================================
+// SETUP/TEARDOWN
+// ============================================================================
+
+void setUp(void) {
+    // Unity calls this before each test
+}
+
+void tearDown(void) {
+    // Unity calls this after each test
+}
+
+// ============================================================================
+// ds::string TESTS
+// ============================================================================
+
+void test_string_copy_and_move(void) {
+    ds::string a("Hello");
+    TEST_ASSERT_EQUAL_UINT(1, a.refcount());
+
+    ds::string b = a; // Copy retains
+    TEST_ASSERT_EQUAL_PTR(a.get(), b.get());
+    TEST_ASSERT_EQUAL_UINT(2, a.refcount());
+
+    ds::string c = std::move(b); // Move leaves the count alone
+    TEST_ASSERT_EQUAL_UINT(2, a.refcount());
+    TEST_ASSERT_NULL(b.get());
+    TEST_ASSERT_TRUE(b.empty());
+    TEST_ASSERT_EQUAL_STRING("", b.c_str());
+
+    c = a; // Self-sharing assignment
+    TEST_ASSERT_EQUAL_UINT(2, a.refcount());
+    {
+        ds::string d = c;
+        TEST_ASSERT_EQUAL_UINT(3, a.refcount());
+    }
+    TEST_ASSERT_EQUAL_UINT(2, a.refcount());
+
+    ds_string raw = a.release();
+    TEST_ASSERT_EQUAL_UINT(2, ds_refcount(raw));
+    ds::string adopted = ds::string::adopt(raw);
+    TEST_ASSERT_EQUAL_STRING("Hello", adopted.c_str());
+}
+
+void test_string_view_interop(void) {
+    std::string_view source("key=value;ignored", 9);
+    ds::string str(source); // Reads exactly 9 bytes, no strlen
+    TEST_ASSERT_EQUAL_UINT(9, str.size());
+    TEST_ASSERT_EQUAL_STRING("key=value", str.c_str());
+
+    std::string_view view = str;
+    TEST_ASSERT_EQUAL_PTR(str.get(), view.data());
+    TEST_ASSERT_TRUE(str == "key=value");
+
+    ds::string with_null(std::string_view("a\0b", 3));
+    TEST_ASSERT_EQUAL_UINT(3, with_null.size());
+
+    ds::string joined = str + std::string_view("&x=1");
+    TEST_ASSERT_EQUAL_STRING("key=value&x=1", joined.c_str());
+    TEST_ASSERT_EQUAL_UINT(13, ds_length(joined.get()));
+    TEST_ASSERT_EQUAL_UINT(4, joined.find("value"));
+    TEST_ASSERT_TRUE(joined.starts_with("key"));
+    TEST_ASSERT_TRUE(joined.ends_with("x=1"));
+    TEST_ASSERT_EQUAL_STRING("value", joined.substr(4, 5).c_str());
+    TEST_ASSERT_EQUAL_STRING("KEY=VALUE", str.to_upper().c_str());
+
+    std::ostringstream out;
+    out << joined;
+    TEST_ASSERT_EQUAL_STRING("key=value&x=1", out.str().c_str());
+}
+
+void test_string_hash(void) {
+    ds::string a("apple");
+    TEST_ASSERT_EQUAL_UINT64(ds_hash(a.get()), std::hash<ds::string>()(a));
+
+    ds::string empty_default;
+    ds::string empty_new("");
+    TEST_ASSERT_EQUAL_UINT64(std::hash<ds::string>()(empty_new), std::hash<ds::string>()(empty_default));
+    TEST_ASSERT_TRUE(empty_new == empty_default);
+
+    std::unordered_set<ds::string> set;
+    set.insert(a);
+    set.insert(ds::string("apple"));
+    set.insert(ds::string("pear"));
+    TEST_ASSERT_EQUAL_UINT(2, set.size());
+    TEST_ASSERT_EQUAL_UINT(1, set.count(ds::string("pear")));
+}
+
+void test_string_length_overloads(void) {
+    using namespace ds::literals;
+    ds::string csv = "a,b,,c"_ds;
+    TEST_ASSERT_EQUAL_UINT(6, csv.size());
+
+    std::vector<ds::string> parts = csv.split(",");
+    TEST_ASSERT_EQUAL_UINT(4, parts.size());
+    TEST_ASSERT_TRUE(parts[2].empty());
+    TEST_ASSERT_TRUE(parts[3] == "c");
+
+    TEST_ASSERT_EQUAL_STRING("a;b,,c", csv.replace(",", ";").c_str());
+    TEST_ASSERT_EQUAL_STRING("a::b::::c", csv.replace_all(",", "::").c_str());
+    TEST_ASSERT_EQUAL_UINT(0, ds::string().split(",")[0].size());
+}
+
+// ============================================================================
+// ds::builder TESTS
+// ============================================================================
+
+void test_builder_wrapper(void) {
+    ds::builder sb;
+    sb << "id=" << 42 << ',' << std::string_view("name=xyz", 7);
+    sb.append_char(0x263A);
+    TEST_ASSERT_EQUAL_STRING("id=42,name=xy\xE2\x98\xBA", sb.c_str());
+
+    ds::string first = sb.to_string();
+    TEST_ASSERT_EQUAL_STRING("id=42,name=xy\xE2\x98\xBA", first.c_str());
+    TEST_ASSERT_EQUAL_UINT(0, sb.size()); // Reusable after conversion
+
+    sb << first << "!";
+    ds::builder moved = std::move(sb);
+    ds::string second = moved.to_string();
+    TEST_ASSERT_EQUAL_STRING("id=42,name=xy\xE2\x98\xBA!", second.c_str());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    // ds::string tests
+    RUN_TEST(test_string_copy_and_move);
+    RUN_TEST(test_string_view_interop);
+    RUN_TEST(test_string_hash);
+    RUN_TEST(test_string_length_overloads);
+
+    // ds::builder tests
+    RUN_TEST(test_builder_wrapper);
+
+    return UNITY_END();
+}